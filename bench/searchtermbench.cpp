@@ -0,0 +1,109 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "searchterm.h"
+#include <QTest>
+#include <QUrl>
+#include <algorithm>
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// The former percent encoder, a UTF-8 round trip for non-ASCII terms
+template<typename It>
+static QString encodeUnits(It begin, It end)
+{
+    static const char16_t hex_digits[] = u"0123456789ABCDEF";
+    QString out(3 * (end - begin), Qt::Uninitialized);
+    auto *o = out.data();
+    for (auto it = begin; it != end; ++it)
+    {
+        const auto u = static_cast<unsigned char>(*it);
+        if (('0' <= u && u <= '9') || ('A' <= u && u <= 'Z') || ('a' <= u && u <= 'z')
+            || u == '-' || u == '.' || u == '_' || u == '~')
+            *o++ = char16_t(u);
+        else
+        {
+            *o++ = u'%';
+            *o++ = hex_digits[u >> 4];
+            *o++ = hex_digits[u & 0xF];
+        }
+    }
+    out.truncate(o - out.data());
+    return out;
+}
+
+static QString formerPercentEncoded(const QString &s)
+{
+    const auto *b = s.utf16(), *e = b + s.size();
+    if (std::all_of(b, e, [](char16_t c){ return c < 0x80; }))
+        return encodeUnits(b, e);
+
+    const auto utf8 = s.toUtf8();
+    return encodeUnits(utf8.cbegin(), utf8.cend());
+}
+
+// Repeats sample up to size chars, without splitting surrogate pairs
+static QString input(const QString &sample, qsizetype size)
+{
+    QString s = sample.repeated(size / sample.size() + 1).left(size);
+    if (!s.isEmpty() && s.back().isHighSurrogate())
+        s.back() = u'x';
+    return s;
+}
+
+static void addRows()
+{
+    QTest::addColumn<QString>("input");
+
+    const std::pair<const char *, QString> samples[]{
+        {"ascii", u"albert launcher-0.27_web~search "_s},
+        {"reserved", u"a+b=c & d/e?f#g "_s},
+        {"unicode", u"Grüße aus Köln, 東京 🙂 "_s}
+    };
+
+    for (const auto &[name, sample] : samples)
+        for (int size : {10, 1024, 64 * 1024})
+            QTest::addRow("%s %d", name, size) << input(sample, size);
+}
+
+}
+
+class SearchTermBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+
+    void identical_data() { addRows(); }
+    void identical()
+    {
+        QFETCH(QString, input);
+        const auto expected = QString::fromLatin1(QUrl::toPercentEncoding(input));
+        QCOMPARE(SearchTerm(input).percentEncoded(), expected);
+        QCOMPARE(formerPercentEncoded(input), expected);
+    }
+
+    void encoder_data() { addRows(); }
+    void encoder()
+    {
+        QFETCH(QString, input);
+        QBENCHMARK { SearchTerm(input).percentEncoded(); }
+    }
+
+    void formerEncoder_data() { addRows(); }
+    void formerEncoder()
+    {
+        QFETCH(QString, input);
+        QBENCHMARK { formerPercentEncoded(input); }
+    }
+
+    void qurlEncoder_data() { addRows(); }
+    void qurlEncoder()
+    {
+        QFETCH(QString, input);
+        QBENCHMARK { QUrl::toPercentEncoding(input); }
+    }
+};
+
+QTEST_GUILESS_MAIN(SearchTermBench)
+#include "searchtermbench.moc"
@@ -0,0 +1,82 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "appendlog.h"
+#include <QFile>
+#include <QSaveFile>
+#include <albert/logging.h>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+AppendLog::AppendLog(const QString &path, int flush_delay) : path_(path)
+{
+    writer_.setMaxThreadCount(1);  // Keeps writes ordered
+    timer_.setSingleShot(true);
+    timer_.setInterval(flush_delay);
+    connect(&timer_, &QTimer::timeout, this, &AppendLog::flush);
+}
+
+AppendLog::~AppendLog()
+{
+    timer_.stop();
+    flush();
+    writer_.waitForDone();
+}
+
+QList<QByteArray> AppendLog::read() const
+{
+    QList<QByteArray> records;
+    if (QFile f(path_); f.open(QIODevice::ReadOnly))
+        for (auto &line : f.readAll().split('\n'))
+            if (!line.isEmpty())
+                records.emplace_back(::move(line));
+    return records;
+}
+
+void AppendLog::append(QByteArray record)
+{
+    QMutexLocker l(&mutex_);
+    pending_.emplace_back(::move(record));
+    if (pending_.size() == 1)  // Timer lives in the thread of this object
+        QMetaObject::invokeMethod(&timer_, qOverload<>(&QTimer::start));
+}
+
+void AppendLog::rewrite(QList<QByteArray> records)
+{
+    {
+        QMutexLocker l(&mutex_);
+        pending_.clear();
+    }
+
+    writer_.start([path=path_, records=::move(records)]{
+        QSaveFile f(path);
+        if (f.open(QIODevice::WriteOnly))
+        {
+            for (const auto &record : records)
+                f.write(record + '\n');
+            if (f.commit())
+                return;
+        }
+        WARN << u"Could not rewrite file: '%1' %2."_s.arg(path, f.errorString());
+    });
+}
+
+void AppendLog::flush()
+{
+    QList<QByteArray> batch;
+    {
+        QMutexLocker l(&mutex_);
+        batch.swap(pending_);
+    }
+
+    if (batch.isEmpty())
+        return;
+
+    writer_.start([path=path_, batch=::move(batch)]{
+        QFile f(path);
+        if (f.open(QIODevice::WriteOnly | QIODevice::Append))
+            for (const auto &record : batch)
+                f.write(record + '\n');
+        else
+            WARN << u"Could not write to file: '%1' %2."_s.arg(path, f.errorString());
+    });
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+///
+/// Line based append-only log file.
+///
+/// Appended records are buffered and written in batches by a background
+/// thread. Records must not contain newlines.
+///
+class AppendLog : public QObject
+{
+public:
+    explicit AppendLog(const QString &path, int flush_delay = 1000);
+    ~AppendLog();
+
+    /// Returns the records in the log file. Blocking.
+    QList<QByteArray> read() const;
+
+    /// Appends a record to the log. Thread-safe and non-blocking.
+    void append(QByteArray record);
+
+    /// Replaces the log by records. Pending appends are discarded, i.e.
+    /// records are expected to reflect them.
+    void rewrite(QList<QByteArray> records);
+
+private:
+    void flush();
+
+    const QString path_;
+    QTimer timer_;
+    QThreadPool writer_;
+    QMutex mutex_;
+    QList<QByteArray> pending_;
+};
@@ -0,0 +1,280 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "bangtable.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <albert/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// File layout, native byte order:
+//   Header
+//   quint32 seeds[buckets]    Displacement seed per bucket
+//   Slot slots[count]         Entry per hash value
+//   char strings[]            UTF-8 trigger, name and url per slot, concatenated
+
+namespace {
+
+static const char magic[8] = {'A', 'L', 'B', 'B', 'A', 'N', 'G', '1'};
+static const quint32 keys_per_bucket = 4;
+static const quint32 max_seed = 1u << 24;
+
+struct Header
+{
+    char magic[8];
+    quint32 count;
+    quint32 buckets;
+};
+
+struct Slot
+{
+    quint32 offset;
+    quint16 trigger_length;
+    quint16 name_length;
+    quint32 url_length;
+};
+
+static_assert(sizeof(Header) == 16 && sizeof(Slot) == 12);
+
+// FNV-1a
+static quint64 hashKey(const char *data, qsizetype size)
+{
+    quint64 h = 0xcbf29ce484222325ull;
+    for (qsizetype i = 0; i < size; ++i)
+        h = (h ^ static_cast<uchar>(data[i])) * 0x100000001b3ull;
+    return h;
+}
+
+// SplitMix64 finalizer
+static quint64 mix(quint64 x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static quint32 bucketOf(quint64 h, quint32 buckets)
+{ return static_cast<quint32>((h >> 32) % buckets); }
+
+static quint32 slotOf(quint64 h, quint32 seed, quint32 count)
+{ return static_cast<quint32>(mix(h ^ (seed * 0x9e3779b97f4a7c15ull)) % count); }
+
+struct Record
+{
+    QByteArray trigger;
+    QByteArray name;
+    QByteArray url;
+};
+
+}
+
+BangTable::BangTable(const QString &path) : file_(path)
+{
+    if (!file_.exists())
+        return;
+
+    if (!file_.open(QIODevice::ReadOnly) || !(data_ = file_.map(0, file_.size())))
+    {
+        WARN << u"Could not map bang table '%1': %2"_s.arg(path, file_.errorString());
+        data_ = nullptr;
+        return;
+    }
+
+    size_ = file_.size();
+    Header header{};
+    if (size_ >= qint64(sizeof(Header)))
+        memcpy(&header, data_, sizeof(Header));
+
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0
+        || header.count == 0 || header.buckets == 0
+        || size_ < qint64(sizeof(Header) + sizeof(quint32) * header.buckets + sizeof(Slot) * header.count))
+    {
+        WARN << u"Invalid bang table '%1'."_s.arg(path);
+        data_ = nullptr;
+        return;
+    }
+
+    count_ = header.count;
+    buckets_ = header.buckets;
+}
+
+bool BangTable::isValid() const
+{ return data_; }
+
+uint BangTable::size() const
+{ return count_; }
+
+optional<BangTable::Bang> BangTable::lookup(QStringView trigger) const
+{
+    if (!data_ || trigger.isEmpty() || trigger.size() > max_trigger_length)
+        return {};
+
+    // Lowercase ASCII triggers on the stack, others take the slow path
+    char buffer[max_trigger_length];
+    QByteArray utf8;
+    const char *key = buffer;
+    qsizetype key_length = trigger.size();
+    for (qsizetype i = 0; i < trigger.size(); ++i)
+    {
+        const auto c = trigger[i].unicode();
+        if (c >= 0x80)
+        {
+            utf8 = trigger.toString().toLower().toUtf8();
+            key = utf8.constData();
+            key_length = utf8.size();
+            break;
+        }
+        buffer[i] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+
+    const auto h = hashKey(key, key_length);
+    const auto *seeds = reinterpret_cast<const quint32*>(data_ + sizeof(Header));
+    const auto *slots = reinterpret_cast<const Slot*>(seeds + buckets_);
+    const auto *strings = reinterpret_cast<const char*>(slots + count_);
+    const auto strings_size = size_ - (strings - reinterpret_cast<const char*>(data_));
+
+    const auto &slot = slots[slotOf(h, seeds[bucketOf(h, buckets_)], count_)];
+    if (slot.trigger_length != key_length
+        || qint64(slot.offset) + slot.trigger_length + slot.name_length + slot.url_length > strings_size
+        || memcmp(strings + slot.offset, key, key_length) != 0)
+        return {};
+
+    const auto *name = strings + slot.offset + slot.trigger_length;
+    return Bang{QString::fromUtf8(name, slot.name_length),
+                QString::fromUtf8(name + slot.name_length, slot.url_length)};
+}
+
+uint BangTable::compile(const QString &json_path, const QString &path)
+{
+    QFile in(json_path);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        WARN << u"Could not read bangs '%1': %2"_s.arg(json_path, in.errorString());
+        return 0;
+    }
+
+    QJsonParseError error;
+    const auto doc = QJsonDocument::fromJson(in.readAll(), &error);
+    if (!doc.isArray())
+    {
+        WARN << u"Invalid bangs '%1': %2"_s.arg(json_path, error.errorString());
+        return 0;
+    }
+
+    // DuckDuckGo format: [{"t": trigger, "s": name, "u": url with {{{s}}}}, …]
+    vector<Record> records;
+    QSet<QByteArray> triggers;
+    const auto array = doc.array();
+    for (const auto &v : array)
+    {
+        const auto o = v.toObject();
+        Record r{o[u"t"_s].toString().toLower().toUtf8(),
+                 o[u"s"_s].toString().toUtf8(),
+                 o[u"u"_s].toString().replace(u"{{{s}}}"_s, u"%s"_s).toUtf8()};
+
+        if (r.trigger.isEmpty() || !r.url.contains("://")
+            || r.trigger.size() > max_trigger_length || r.name.size() > 0xFFFF
+            || triggers.contains(r.trigger))
+            continue;
+
+        triggers.insert(r.trigger);
+        records.emplace_back(::move(r));
+    }
+
+    if (records.empty())
+    {
+        WARN << u"No bangs in '%1'."_s.arg(json_path);
+        return 0;
+    }
+
+    // Hash and displace. Place the largest buckets first, each with the
+    // first seed mapping all of its keys to free slots.
+    const auto count = static_cast<quint32>(records.size());
+    const quint32 buckets = count / keys_per_bucket + 1;
+
+    vector<quint64> hashes(count);
+    vector<vector<quint32>> bucket_keys(buckets);
+    for (quint32 k = 0; k < count; ++k)
+    {
+        hashes[k] = hashKey(records[k].trigger.constData(), records[k].trigger.size());
+        bucket_keys[bucketOf(hashes[k], buckets)].push_back(k);
+    }
+
+    vector<quint32> order(buckets);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](quint32 a, quint32 b)
+                { return bucket_keys[a].size() > bucket_keys[b].size(); });
+
+    vector<quint32> seeds(buckets, 0);
+    vector<qint64> slot_keys(count, -1);
+    vector<quint32> placed;
+    for (quint32 b : order)
+    {
+        const auto &keys = bucket_keys[b];
+        if (keys.empty())
+            break;
+
+        quint32 seed = 0;
+        for (; seed < max_seed; ++seed)
+        {
+            placed.clear();
+            for (quint32 k : keys)
+            {
+                const auto s = slotOf(hashes[k], seed, count);
+                if (slot_keys[s] >= 0 || find(placed.begin(), placed.end(), s) != placed.end())
+                    break;
+                placed.push_back(s);
+            }
+            if (placed.size() == keys.size())
+                break;
+        }
+
+        if (seed == max_seed)
+        {
+            WARN << u"Could not build the bang table of '%1'."_s.arg(json_path);
+            return 0;
+        }
+
+        seeds[b] = seed;
+        for (size_t i = 0; i < keys.size(); ++i)
+            slot_keys[placed[i]] = keys[i];
+    }
+
+    vector<Slot> slots(count);
+    QByteArray strings;
+    for (quint32 s = 0; s < count; ++s)
+    {
+        const auto &r = records[slot_keys[s]];
+        slots[s] = {static_cast<quint32>(strings.size()),
+                    static_cast<quint16>(r.trigger.size()),
+                    static_cast<quint16>(r.name.size()),
+                    static_cast<quint32>(r.url.size())};
+        strings.append(r.trigger).append(r.name).append(r.url);
+    }
+
+    Header header;
+    memcpy(header.magic, magic, sizeof(magic));
+    header.count = count;
+    header.buckets = buckets;
+
+    QSaveFile out(path);
+    if (out.open(QIODevice::WriteOnly))
+    {
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(seeds.data()), sizeof(quint32) * seeds.size());
+        out.write(reinterpret_cast<const char*>(slots.data()), sizeof(Slot) * slots.size());
+        out.write(strings);
+        if (out.commit())
+            return count;
+    }
+
+    WARN << u"Could not write bang table '%1': %2"_s.arg(path, out.errorString());
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QFile>
+#include <QString>
+#include <QStringView>
+#include <optional>
+
+///
+/// Read-only table of bangs, e.g. "!w" for Wikipedia.
+///
+/// Bang datasets hold thousands of entries, too many for the engine list.
+/// They are compiled once into a file holding a minimal perfect hash table,
+/// which is memory mapped. Opening reads nothing but the header, a lookup
+/// hashes the trigger and compares a single entry.
+///
+class BangTable
+{
+public:
+    struct Bang
+    {
+        QString name;
+        QString url;  // Template, see SearchTerm
+    };
+
+    /// Maps the table file at path.
+    explicit BangTable(const QString &path);
+
+    bool isValid() const;
+    uint size() const;
+
+    /// Returns the bang of the case-insensitive trigger, without the '!'.
+    std::optional<Bang> lookup(QStringView trigger) const;
+
+    /// Compiles the bang dataset at json_path, e.g. DuckDuckGo's bang.js,
+    /// to a table file at path. Returns the number of bangs, 0 on failure.
+    static uint compile(const QString &json_path, const QString &path);
+
+    static const qsizetype max_trigger_length = 64;  // UTF-8 bytes
+
+private:
+    QFile file_;
+    const uchar *data_ = nullptr;
+    qint64 size_ = 0;
+    quint32 count_ = 0;
+    quint32 buckets_ = 0;
+};
@@ -4,34 +4,64 @@
 #include "plugin.h"
 #include "searchengineeditor.h"
 #include <QAbstractTableModel>
+#include <QAction>
+#include <QCache>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QIcon>
+#include <QInputDialog>
+#include <QListWidget>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QSet>
 #include <QSortFilterProxyModel>
+#include <QStandardPaths>
 #include <QUuid>
+#include <QtConcurrentRun>
 #include <albert/logging.h>
 enum class Section{ Name, Trigger, Fallback, URL} ;
 static const int sectionCount = 4;
+static const int iconCacheLimit = 10000;  // Distinct icons kept in the model, LRU evicted
+static const size_t historyLimit = 50;
 using namespace Qt::StringLiterals;
 using namespace std;
 
 class EnginesModel final : public QAbstractTableModel
 {
     Plugin *plugin_;
-    mutable std::map<QString,QIcon> iconCache;
+    mutable QCache<QString, QIcon> iconCache;
+
+    void fillIconCache()
+    {
+        // Keep the icons still in use, changes usually affect few engines
+        QSet<QString> icon_paths;
+        for (const auto &e : plugin_->engines())
+            icon_paths.insert(e->icon_path);
+
+        for (const auto &icon_path : iconCache.keys())
+            if (!icon_paths.contains(icon_path))
+                iconCache.remove(icon_path);
+
+        for (const auto &icon_path : std::as_const(icon_paths))
+            if (iconCache.size() < iconCache.maxCost() && !iconCache.contains(icon_path))
+                iconCache.insert(icon_path, new QIcon(plugin_->iconCache().icon(icon_path)));
+    }
 
 public:
     EnginesModel(Plugin *plugin, QObject *parent):
         QAbstractTableModel(parent),
-        plugin_(plugin)
+        plugin_(plugin),
+        iconCache(iconCacheLimit)
     {
+        fillIconCache();
         connect(plugin, &Plugin::enginesChanged, this, [this](){
             beginResetModel();
-            iconCache.clear();
+            fillIconCache();
             endResetModel();
         });
     }
@@ -68,13 +98,14 @@ public:
             case Section::Trigger:
                 switch (role) {
                 case Qt::DisplayRole: return ConfigWidget::tr("Short");
-                case Qt::ToolTipRole: return ConfigWidget::tr("Short name you can utilize for quick access.");
+                case Qt::ToolTipRole: return ConfigWidget::tr("Short names you can utilize for quick access, separated by commas.");
                 default: return {};
                 }
             case Section::URL:
                 switch (role) {
                 case Qt::DisplayRole: return ConfigWidget::tr("URL");
-                case Qt::ToolTipRole: return ConfigWidget::tr("The URL of this search engine. %s will be replaced by your search term.");
+                case Qt::ToolTipRole: return ConfigWidget::tr("The URL of this search engine. %s will be replaced by your search term, "
+                                                              "%q, %p and %r by its form, path and unencoded variants.");
                 default: return {};
                 }
             case Section::Fallback:
@@ -94,7 +125,7 @@ public:
             index.column() >= sectionCount )
             return QVariant();
 
-        const auto &se = plugin_->engines()[static_cast<ulong>(index.row())];
+        const auto &se = *plugin_->engines()[static_cast<ulong>(index.row())];
 
         switch (role) {
         case Qt::DisplayRole:
@@ -104,11 +135,26 @@ public:
             case Section::Name:
                 return se.name;
             case Section::Trigger:{
-                auto trigger = se.trigger;
-                return trigger.replace(u' ', u'•');
+                if (role == Qt::EditRole)
+                    return se.triggers.join(u", "_s);
+                if (se.triggers.isEmpty() && !se.pattern.isEmpty())
+                    return u"/%1/"_s.arg(se.pattern);
+                auto triggers = se.triggers;
+                for (auto &trigger : triggers)
+                    trigger.replace(u' ', u'•');
+                return triggers.join(u", "_s);
             }
             case Section::URL:
-                return se.url;
+                if (se.members.isEmpty())
+                    return se.url;
+                else
+                {
+                    QStringList names;
+                    for (const auto &id : se.members)
+                        if (auto *m = plugin_->engine(id))
+                            names << m->name;
+                    return u"→ %1"_s.arg(names.join(u", "_s));
+                }
             default: break;
             }
             break;
@@ -118,15 +164,14 @@ public:
             if ((Section)index.column() == Section::Name) {
                 // Resizing request thounsands of repaints. Creating an icon for
                 // ever paint event is to expensive. Therefor maintain an icon cache
-                auto icon_url = se.icon_path;
-                try {
-                    return iconCache.at(icon_url);
-                } catch (const out_of_range &) {
-                    if (QUrl url(icon_url); url.isLocalFile())
-                        return iconCache.emplace(icon_url, QIcon(url.toLocalFile())).first->second;
-                    else
-                        return iconCache.emplace(icon_url, QIcon(icon_url)).first->second;
-                }
+                // that is filled on reset.
+                if (const auto *icon = iconCache.object(se.icon_path))
+                    return *icon;
+
+                auto *icon = new QIcon(plugin_->iconCache().icon(se.icon_path));
+                const QIcon copy = *icon;
+                iconCache.insert(se.icon_path, icon);
+                return copy;
             }
             break;
         }
@@ -151,9 +196,10 @@ public:
             {
                 try {
                     auto engines = plugin_->engines();
-                    auto &engine = engines[index.row()];
-                    engine.trigger = value.toString();
-                    plugin_->setEngines(engines);
+                    auto engine = *engines.at(index.row());
+                    engine.triggers = SearchEngineEditor::splitTriggers(value.toString());
+                    engines[index.row()] = make_shared<const SearchEngine>(::move(engine));
+                    plugin_->setEngines(::move(engines));
                     return true;
                 }
                 catch (std::out_of_range &e){}
@@ -165,9 +211,10 @@ public:
             {
                 try {
                     auto engines = plugin_->engines();
-                    auto &engine = engines[index.row()];
+                    auto engine = *engines.at(index.row());
                     engine.fallback = value == Qt::Checked;
-                    plugin_->setEngines(engines);
+                    engines[index.row()] = make_shared<const SearchEngine>(::move(engine));
+                    plugin_->setEngines(::move(engines));
                     return true;
                 }
                 catch (std::out_of_range &e){}
@@ -186,10 +233,30 @@ ConfigWidget::ConfigWidget(Plugin *plugin, QWidget *parent)
 {
     ui.setupUi(this);
 
-    ui.tableView_searches->setModel(new EnginesModel(plugin, ui.tableView_searches));
-    ui.tableView_searches->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);  // requires a model!
-    ui.tableView_searches->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);  // requires a model!
-    ui.tableView_searches->horizontalHeader()->setStretchLastSection(true);
+    enginesModel_ = new EnginesModel(plugin, this);
+    proxyModel = new QSortFilterProxyModel(this);
+    proxyModel->setSourceModel(enginesModel_);
+    proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    proxyModel->setFilterKeyColumn(-1);  // all columns
+    ui.tableView_searches->setModel(proxyModel);
+
+    connect(ui.lineEdit_filter, &QLineEdit::textChanged,
+            proxyModel, &QSortFilterProxyModel::setFilterFixedString);
+
+    // Measuring every cell on each reset does not scale to large engine
+    // lists. Use uniform row heights and size the columns on a sample.
+    auto *vh = ui.tableView_searches->verticalHeader();
+    vh->setSectionResizeMode(QHeaderView::Fixed);
+    vh->setDefaultSectionSize(max(ui.tableView_searches->iconSize().height(),
+                                  fontMetrics().height()) + 6);
+
+    auto *hh = ui.tableView_searches->horizontalHeader();
+    hh->setSectionResizeMode(QHeaderView::Interactive);
+    hh->setResizeContentsPrecision(100);
+    hh->setStretchLastSection(true);
+    ui.tableView_searches->resizeColumnsToContents();
+    connect(enginesModel_, &QAbstractItemModel::modelReset,
+            ui.tableView_searches, &QTableView::resizeColumnsToContents);
 
     connect(ui.pushButton_new, &QPushButton::clicked,
             this, &ConfigWidget::onButton_new);
@@ -200,97 +267,378 @@ ConfigWidget::ConfigWidget(Plugin *plugin, QWidget *parent)
     connect(ui.pushButton_restoreDefaults, &QPushButton::clicked,
             this, &ConfigWidget::onButton_restoreDefaults);
 
+    connect(ui.pushButton_importBangs, &QPushButton::clicked,
+            this, &ConfigWidget::onImportBangs);
+
     connect(ui.tableView_searches, &QTableView::activated,
             this, &ConfigWidget::onActivated);
 
+    // Bulk actions on the selection
+
+    auto *action = new QAction(tr("Remove"), ui.tableView_searches);
+    connect(action, &QAction::triggered, this, &ConfigWidget::onButton_remove);
+    ui.tableView_searches->addAction(action);
+
+    action = new QAction(tr("Toggle fallback"), ui.tableView_searches);
+    connect(action, &QAction::triggered, this, &ConfigWidget::onToggleFallback);
+    ui.tableView_searches->addAction(action);
+
+    action = new QAction(tr("Set icon…"), ui.tableView_searches);
+    connect(action, &QAction::triggered, this, &ConfigWidget::onSetIcon);
+    ui.tableView_searches->addAction(action);
+
+    action = new QAction(tr("Find and replace in URLs…"), ui.tableView_searches);
+    connect(action, &QAction::triggered, this, &ConfigWidget::onReplaceInUrls);
+    ui.tableView_searches->addAction(action);
+
+    // Undo history
+
+    undoAction_ = new QAction(tr("Undo"), this);
+    undoAction_->setShortcut(QKeySequence::Undo);
+    undoAction_->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(undoAction_, &QAction::triggered, this, &ConfigWidget::undo);
+    addAction(undoAction_);
+    ui.tableView_searches->addAction(undoAction_);
+
+    redoAction_ = new QAction(tr("Redo"), this);
+    redoAction_->setShortcut(QKeySequence::Redo);
+    redoAction_->setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    connect(redoAction_, &QAction::triggered, this, &ConfigWidget::redo);
+    addAction(redoAction_);
+    ui.tableView_searches->addAction(redoAction_);
+
+    snapshot_ = plugin->engines();
+    undoAction_->setEnabled(false);
+    redoAction_->setEnabled(false);
+
+    connect(plugin, &Plugin::enginesChanged,
+            this, &ConfigWidget::updateHistory);
+
+    updateFallbackList();
+
+    connect(plugin, &Plugin::enginesChanged,
+            this, &ConfigWidget::updateFallbackList);
+
+    // Rows up to the moved ones get a user-defined position, the rest
+    // keeps ranking by usage
+    connect(ui.listWidget_fallbacks->model(), &QAbstractItemModel::rowsMoved, this,
+            [this](const QModelIndex &, int start, int end, const QModelIndex &, int row){
+        const auto last = row > start ? row - 1 : row + end - start;  // Of the moved rows
+        const auto count = max(static_cast<int>(plugin_->orderedFallbackCount()), last + 1);
+        QStringList ids;
+        for (int i = 0; i < min(count, ui.listWidget_fallbacks->count()); ++i)
+            ids << ui.listWidget_fallbacks->item(i)->data(Qt::UserRole).toString();
+        plugin_->setFallbackOrder(ids);
+    });
+
+    ui.spinBox_fallbackLimit->setValue(static_cast<int>(plugin->fallbackLimit()));
+    connect(ui.spinBox_fallbackLimit, &QSpinBox::valueChanged,
+            this, [this](int value){ plugin_->setFallbackLimit(static_cast<uint>(value)); });
 }
 
-static void handleAcceptedEditor(const SearchEngineEditor &editor, SearchEngine &engine, const Plugin &plugin)
+ConfigWidget::~ConfigWidget()
 {
-    if (editor.icon_image){  // If icon changed copy the file
-
-        // If there has been a user icon remove it
-        if (QUrl url(engine.icon_path); url.isLocalFile())
-            QFile::moveToTrash(url.toLocalFile());
+    // The history ends with the widget
+    auto dropped = ::move(undoStack_);
+    dropped.insert(dropped.end(), make_move_iterator(redoStack_.begin()), make_move_iterator(redoStack_.end()));
+    undoStack_.clear();
+    redoStack_.clear();
+    releaseIcons(dropped);
+}
 
-        auto image = editor.icon_image->scaled(256, 256, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+void ConfigWidget::updateFallbackList()
+{
+    ui.listWidget_fallbacks->clear();
+    for (const SearchEngine *e : plugin_->fallbackEngines())
+    {
+        auto *item = new QListWidgetItem(plugin_->iconCache().icon(e->icon_path), e->name,
+                                         ui.listWidget_fallbacks);
+        item->setData(Qt::UserRole, e->id);
+    }
+}
 
-        auto dst = QDir(plugin.dataLocation()).filePath(engine.id) + u".png"_s;
-        if (!image.save(dst)){
-            auto msg = ConfigWidget::tr("Could not save image to '%1'.").arg(dst);
-            WARN << msg;
-            QMessageBox::warning(nullptr, qApp->applicationDisplayName(), msg);
-            return;
-        }
+// Returns the file of an icon written by writeIcon, empty for other icons
+static QString userIconFile(const QString &icon_path, const Plugin &plugin)
+{
+    const QUrl url(icon_path);
+    const QFileInfo info(url.isLocalFile() ? url.toLocalFile() : icon_path);
+    if (info.isAbsolute() && info.absolutePath() == QDir(plugin.dataLocation()).absolutePath())
+        return info.absoluteFilePath();
+    return {};
+}
 
-        // set url
-        engine.icon_path = dst;
+static bool writeIcon(const QByteArray &png, SearchEngine &engine, const Plugin &plugin)
+{
+    // Files are named by content and never overwritten, the icons replaced
+    // stay valid for the undo history. See releaseIcons.
+    const auto hash = QCryptographicHash::hash(png, QCryptographicHash::Sha1).toHex().left(16);
+    auto dst = QDir(plugin.dataLocation()).filePath(u"%1-%2.png"_s.arg(engine.id, QString::fromLatin1(hash)));
+    if (QFile f(dst); !f.exists() && (!f.open(QIODevice::WriteOnly) || f.write(png) != png.size())){
+        auto msg = ConfigWidget::tr("Could not save image to '%1'.").arg(dst);
+        WARN << msg;
+        QMessageBox::warning(nullptr, qApp->applicationDisplayName(), msg);
+        return false;
     }
 
-    engine.name = editor.name();
-    engine.trigger = editor.trigger();
-    engine.url = editor.url();
-    engine.fallback = editor.fallback();
+    // set url
+    engine.icon_path = dst;
+    return true;
+}
+
+static void handleAcceptedEditor(const SearchEngineEditor &editor, SearchEngine &engine, const Plugin &plugin)
+{
+    // If icon changed write the file
+    auto edited = editor.searchEngine();
+    if (!editor.icon_png.isEmpty() && !writeIcon(editor.icon_png, edited, plugin))
+        return;
+    engine = ::move(edited);
+}
+
+static vector<SearchEngine> groupCandidates(const EngineList &engines, const QString &group_id = {})
+{
+    vector<SearchEngine> candidates;
+    for (const auto &e : engines)
+        if (e->members.isEmpty() && e->id != group_id)
+            candidates.emplace_back(*e);
+    return candidates;
 }
 
 void ConfigWidget::onActivated(QModelIndex index)
 {
+    index = proxyModel->mapToSource(index);
+
     if ((Section)index.column() == Section::Trigger)
     {
-        ui.tableView_searches->edit(index);
+        ui.tableView_searches->edit(proxyModel->mapFromSource(index));
         return;
     }
 
-    auto engines = plugin_->engines();
-    auto &engine = engines[index.row()];
-
-    SearchEngineEditor editor(engine.icon_path,
-                              engine.name,
-                              engine.trigger,
-                              engine.url,
-                              engine.fallback,
-                              this);
+    auto engine = *plugin_->engines()[index.row()];
+    SearchEngineEditor editor(engine, groupCandidates(plugin_->engines(), engine.id), this);
 
     if (editor.exec()){
         handleAcceptedEditor(editor, engine, *plugin_);
-        plugin_->setEngines(engines);
+        auto engines = plugin_->engines();  // May have been reloaded meanwhile
+        for (auto &e : engines)
+            if (e->id == engine.id)
+                e = make_shared<const SearchEngine>(engine);
+        plugin_->setEngines(::move(engines));
     }
 }
 
 void ConfigWidget::onButton_new()
 {
-    if (SearchEngineEditor editor(u":default"_s, {}, {}, {}, false, this); editor.exec()){
-        SearchEngine engine;
-        engine.id = QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
-        engine.icon_path = u":default"_s;
+    SearchEngine engine;
+    engine.id = QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
+    engine.icon_path = u":default"_s;
+    engine.fallback = false;
+
+    if (SearchEngineEditor editor(engine, groupCandidates(plugin_->engines()), this);
+        editor.exec()){
         handleAcceptedEditor(editor, engine, *plugin_);
         auto engines = plugin_->engines();
-        engines.emplace_back(engine);
-        plugin_->setEngines(engines);
+        engines.emplace_back(make_shared<const SearchEngine>(::move(engine)));
+        plugin_->setEngines(::move(engines));
     }
 }
 
+void ConfigWidget::updateHistory()
+{
+    vector<Snapshot> dropped;
+    if (!restoring_)
+    {
+        undoStack_.emplace_back(::move(snapshot_));
+        if (undoStack_.size() > historyLimit)
+        {
+            dropped.emplace_back(::move(undoStack_.front()));
+            undoStack_.erase(undoStack_.begin());
+        }
+        dropped.insert(dropped.end(), make_move_iterator(redoStack_.begin()), make_move_iterator(redoStack_.end()));
+        redoStack_.clear();
+    }
+
+    // The engines of the plugin are shared, a snapshot is a copy of pointers
+    snapshot_ = plugin_->engines();
+    undoAction_->setEnabled(!undoStack_.empty());
+    redoAction_->setEnabled(!redoStack_.empty());
+    releaseIcons(dropped);
+}
+
+void ConfigWidget::releaseIcons(const vector<Snapshot> &dropped)
+{
+    // Trash the icons written by writeIcon that only dropped snapshots refer to
+    QSet<QString> icon_paths;
+    for (const auto &snapshot : dropped)
+        for (const auto &e : snapshot)
+            if (!userIconFile(e->icon_path, *plugin_).isEmpty())
+                icon_paths.insert(e->icon_path);
+
+    const auto keepReferenced = [&](const Snapshot &snapshot)
+    {
+        for (auto it = snapshot.begin(); it != snapshot.end() && !icon_paths.isEmpty(); ++it)
+            icon_paths.remove((*it)->icon_path);
+    };
+
+    keepReferenced(plugin_->engines());
+    keepReferenced(snapshot_);
+    for (const auto &snapshot : undoStack_)
+        keepReferenced(snapshot);
+    for (const auto &snapshot : redoStack_)
+        keepReferenced(snapshot);
+
+    for (const auto &icon_path : std::as_const(icon_paths))
+        QFile::moveToTrash(userIconFile(icon_path, *plugin_));
+}
+
+void ConfigWidget::restore(const Snapshot &snapshot)
+{
+    restoring_ = true;
+    plugin_->setEngines(snapshot);
+    restoring_ = false;
+}
+
+void ConfigWidget::undo()
+{
+    if (undoStack_.empty())
+        return;
+
+    auto snapshot = ::move(undoStack_.back());
+    undoStack_.pop_back();
+    redoStack_.emplace_back(snapshot_);
+    restore(snapshot);
+}
+
+void ConfigWidget::redo()
+{
+    if (redoStack_.empty())
+        return;
+
+    auto snapshot = ::move(redoStack_.back());
+    redoStack_.pop_back();
+    undoStack_.emplace_back(snapshot_);
+    restore(snapshot);
+}
+
+// Ids instead of rows, modal dialogs run an event loop and the engines
+// may change meanwhile, e.g. by a reload of the engines file.
+QSet<QString> ConfigWidget::selectedIds() const
+{
+    QSet<QString> ids;
+    for (const auto &index : ui.tableView_searches->selectionModel()->selectedRows())
+        ids.insert(plugin_->engines()[proxyModel->mapToSource(index).row()]->id);
+    return ids;
+}
+
 void ConfigWidget::onButton_remove()
 {
-    auto index = ui.tableView_searches->currentIndex();
-    if (!index.isValid())
+    const auto ids = selectedIds();
+    if (ids.isEmpty())
         return;
 
     auto reply = QMessageBox::question(
         this, qApp->applicationDisplayName(),
-        tr("Do you really want to remove '%1' from the search engines?")
-            .arg(plugin_->engines()[index.row()].name),
+        ids.size() == 1
+            ? tr("Do you really want to remove '%1' from the search engines?")
+                  .arg(plugin_->engine(*ids.cbegin())->name)
+            : tr("Do you really want to remove %n search engines?", nullptr, static_cast<int>(ids.size())),
         QMessageBox::Yes|QMessageBox::No);
     if (reply == QMessageBox::Yes){
+        // Icons are kept for undo, see releaseIcons
         auto engines = plugin_->engines();
-        auto &engine = engines[index.row()];
+        engines.erase(remove_if(engines.begin(), engines.end(),
+                                [&](const auto &e){ return ids.contains(e->id); }),
+                      engines.end());
+        plugin_->setEngines(::move(engines));
+    }
+}
 
-        if (QUrl url(engine.icon_path); url.isLocalFile())
-            QFile::moveToTrash(url.toLocalFile());
+void ConfigWidget::onToggleFallback()
+{
+    const auto ids = selectedIds();
+    if (ids.isEmpty())
+        return;
 
-        engines.erase(engines.begin() + index.row());
-        plugin_->setEngines(engines);
-    }
+    // Enable all unless all are enabled
+    auto engines = plugin_->engines();
+    const bool fallback = any_of(engines.begin(), engines.end(),
+                                 [&](const auto &e){ return ids.contains(e->id) && !e->fallback; });
+    for (auto &e : engines)
+        if (ids.contains(e->id))
+        {
+            auto engine = *e;
+            engine.fallback = fallback;
+            e = make_shared<const SearchEngine>(::move(engine));
+        }
+    plugin_->setEngines(::move(engines));
+}
+
+void ConfigWidget::onSetIcon()
+{
+    const auto ids = selectedIds();
+    if (ids.isEmpty())
+        return;
+
+    QString fileName =
+        QFileDialog::getOpenFileName(
+            this,
+            tr("Choose icon"),
+            QStandardPaths::writableLocation(QStandardPaths::HomeLocation),
+            tr("Images (*.png *.svg)"));
+
+    if (fileName.isEmpty())
+        return;
+
+    // Decode in the background, large images would freeze the widget
+    auto *watcher = new QFutureWatcher<QByteArray>(this);
+    connect(watcher, &QFutureWatcher<QByteArray>::finished, this, [this, watcher, ids]{
+        watcher->deleteLater();
+        const auto png = watcher->result();
+        if (png.isEmpty()){
+            QMessageBox::warning(this, qApp->applicationDisplayName(),
+                                 tr("Could not read the image."));
+            return;
+        }
+
+        auto engines = plugin_->engines();
+        for (auto &e : engines)
+            if (ids.contains(e->id))
+            {
+                auto engine = *e;
+                if (!writeIcon(png, engine, *plugin_))
+                    break;
+                e = make_shared<const SearchEngine>(::move(engine));
+            }
+        plugin_->setEngines(::move(engines));
+    });
+    watcher->setFuture(QtConcurrent::run(&SearchEngineEditor::readIcon, fileName));
+}
+
+void ConfigWidget::onReplaceInUrls()
+{
+    const auto ids = selectedIds();
+    if (ids.isEmpty())
+        return;
+
+    bool ok;
+    const auto before = QInputDialog::getText(this, qApp->applicationDisplayName(),
+                                              tr("Find in URLs:"), QLineEdit::Normal, {}, &ok);
+    if (!ok || before.isEmpty())
+        return;
+
+    const auto after = QInputDialog::getText(this, qApp->applicationDisplayName(),
+                                             tr("Replace with:"), QLineEdit::Normal, {}, &ok);
+    if (!ok)
+        return;
+
+    auto engines = plugin_->engines();
+    for (auto &e : engines)
+        if (ids.contains(e->id) && e->url.contains(before))
+        {
+            auto engine = *e;
+            engine.url.replace(before, after);
+            e = make_shared<const SearchEngine>(::move(engine));
+        }
+    plugin_->setEngines(::move(engines));
 }
 
 void ConfigWidget::onButton_restoreDefaults()
@@ -302,3 +650,30 @@ void ConfigWidget::onButton_restoreDefaults()
     if (reply == QMessageBox::Yes)
         plugin_->restoreDefaultEngines();
 }
+
+void ConfigWidget::onImportBangs()
+{
+    QString fileName =
+        QFileDialog::getOpenFileName(
+            this,
+            tr("Choose bang dataset"),
+            QStandardPaths::writableLocation(QStandardPaths::DownloadLocation),
+            tr("Bangs (*.json *.js)"));
+
+    if (fileName.isEmpty())
+        return;
+
+    ui.pushButton_importBangs->setEnabled(false);
+    auto *watcher = new QFutureWatcher<uint>(this);
+    connect(watcher, &QFutureWatcher<uint>::finished, this, [this, watcher]{
+        ui.pushButton_importBangs->setEnabled(true);
+        if (const auto count = watcher->result(); count)
+            QMessageBox::information(this, qApp->applicationDisplayName(),
+                                     tr("Imported %n bangs.", nullptr, static_cast<int>(count)));
+        else
+            QMessageBox::warning(this, qApp->applicationDisplayName(),
+                                 tr("Could not import the bangs."));
+        watcher->deleteLater();
+    });
+    watcher->setFuture(plugin_->importBangs(fileName));
+}
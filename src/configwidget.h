@@ -1,10 +1,15 @@
 // Copyright (C) 2014-2021 Manuel Schneider
 
 #pragma once
+#include <QSet>
 #include <QWidget>
+#include <memory>
+#include <vector>
 #include "ui_configwidget.h"
 
 class Plugin;
+class QAction;
+struct SearchEngine;
 class EnginesModel;
 class QSortFilterProxyModel;
 
@@ -15,6 +20,7 @@ class ConfigWidget final : public QWidget
 public:
 
     explicit ConfigWidget(Plugin *extension, QWidget *parent = 0);
+    ~ConfigWidget() override;
     Ui::ConfigWidget ui;
 
 private:
@@ -23,8 +29,28 @@ private:
     void onButton_new();
     void onButton_remove();
     void onButton_restoreDefaults();
+    void onImportBangs();
+    void onToggleFallback();
+    void onSetIcon();
+    void onReplaceInUrls();
+    void updateFallbackList();
+    void updateHistory();
+    void undo();
+    void redo();
+    void restore(const std::vector<std::shared_ptr<const SearchEngine>> &snapshot);
+    void releaseIcons(const std::vector<std::vector<std::shared_ptr<const SearchEngine>>> &dropped);
+    QSet<QString> selectedIds() const;
 
     Plugin *plugin_;
     EnginesModel *enginesModel_;
     QSortFilterProxyModel *proxyModel;
+
+    // Undo history. Snapshots share unchanged engines with the plugin.
+    using Snapshot = std::vector<std::shared_ptr<const SearchEngine>>;
+    Snapshot snapshot_;
+    std::vector<Snapshot> undoStack_;
+    std::vector<Snapshot> redoStack_;
+    bool restoring_ = false;
+    QAction *undoAction_;
+    QAction *redoAction_;
 };
@@ -0,0 +1,133 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "iconcache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSet>
+#include <QUrl>
+#include <albert/logging.h>
+#include <array>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// Launcher icon sizes at device pixel ratio 1 and 2. Ascending, the largest
+// is written last and marks a complete set.
+static const array<int, 6> sizes{16, 24, 32, 48, 64, 96};
+
+static QString sourcePath(const QString &icon_path)
+{
+    if (QUrl url(icon_path); url.isLocalFile())
+        return url.toLocalFile();
+    return icon_path;
+}
+
+static QString cacheKey(const QString &icon_path)
+{
+    const auto mtime = QFileInfo(sourcePath(icon_path)).lastModified().toMSecsSinceEpoch();
+    return QString::fromLatin1(
+        QCryptographicHash::hash((icon_path + QString::number(mtime)).toUtf8(),
+                                 QCryptographicHash::Md5).toHex());
+}
+
+IconCache::IconCache(const QString &directory) : directory_(directory)
+{
+    renderer_.setMaxThreadCount(1);
+    QDir().mkpath(directory_);
+}
+
+IconCache::~IconCache()
+{
+    renderer_.clear();
+    renderer_.waitForDone();
+}
+
+QString IconCache::filePath(const QString &key, int px) const
+{ return QDir(directory_).filePath(u"%1-%2.png"_s.arg(key).arg(px)); }
+
+void IconCache::update(const QStringList &icon_paths)
+{
+    QHash<QString, QString> candidates;
+    for (const auto &icon_path : icon_paths)
+        if (!candidates.contains(icon_path))
+            candidates.emplace(icon_path, cacheKey(icon_path));
+
+    // Check for renditions under the lock, the cleanup removes files under it
+    QList<pair<QString, QString>> missing;
+    {
+        QMutexLocker l(&mutex_);
+        keys_.clear();
+        for (auto it = candidates.cbegin(); it != candidates.cend(); ++it)
+            if (QFile::exists(filePath(it.value(), sizes.back())))
+                keys_.emplace(it.key(), it.value());
+            else
+                missing.emplaceBack(it.key(), it.value());
+    }
+
+    renderer_.start([this, missing]{
+        for (const auto &[icon_path, key] : missing)
+        {
+            bool success = true;
+            for (int px : sizes)
+            {
+                QImageReader reader(sourcePath(icon_path));
+                if (const auto size = reader.size(); size.isValid())
+                    reader.setScaledSize(size.scaled(px, px, Qt::KeepAspectRatio));
+
+                auto image = reader.read();
+                if (image.width() > px || image.height() > px)
+                    image = image.scaled(px, px, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+                if (image.isNull() || !image.save(filePath(key, px), "PNG"))
+                {
+                    WARN << u"Failed to cache icon '%1': %2"_s.arg(icon_path, reader.errorString());
+                    success = false;
+                    break;
+                }
+            }
+
+            if (success)
+            {
+                QMutexLocker l(&mutex_);
+                keys_.emplace(icon_path, key);
+            }
+        }
+
+        // Remove renditions of icons not in use anymore. Against the current
+        // keys, an update may have mapped icons to renditions meanwhile.
+        QMutexLocker l(&mutex_);
+        QSet<QString> keep;
+        for (const auto &key : std::as_const(keys_))
+            keep.insert(key);
+
+        QDir dir(directory_);
+        for (const auto &file_name : dir.entryList({u"*.png"_s}, QDir::Files))
+            if (!keep.contains(file_name.section(u'-', 0, 0)))
+                dir.remove(file_name);
+    });
+}
+
+QString IconCache::path(const QString &icon_path, int px) const
+{
+    QMutexLocker l(&mutex_);
+    if (auto it = keys_.constFind(icon_path); it != keys_.cend())
+        for (int size : sizes)
+            if (size >= px || size == sizes.back())
+                return filePath(*it, size);
+    return icon_path;
+}
+
+QIcon IconCache::icon(const QString &icon_path) const
+{
+    QMutexLocker l(&mutex_);
+    if (auto it = keys_.constFind(icon_path); it != keys_.cend())
+    {
+        QIcon icon;
+        for (int px : sizes)
+            icon.addFile(filePath(*it, px), QSize(px, px));
+        return icon;
+    }
+    return QIcon(sourcePath(icon_path));
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QHash>
+#include <QIcon>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+///
+/// Cache of engine icons pre-rendered to PNG at standard sizes.
+///
+/// Renditions are keyed by icon path and modification time and rendered
+/// in the background. Until an icon is cached the original path is used.
+///
+class IconCache
+{
+public:
+    explicit IconCache(const QString &directory);
+    ~IconCache();
+
+    /// Makes the renditions of icon_paths available. Renders missing ones
+    /// in the background and removes the ones of other icons.
+    void update(const QStringList &icon_paths);
+
+    /// Returns the path of the smallest rendition of at least px pixels or
+    /// the original icon path if not cached. Thread-safe.
+    QString path(const QString &icon_path, int px) const;
+
+    /// Returns an icon of all renditions or of the original icon path if not cached.
+    QIcon icon(const QString &icon_path) const;
+
+private:
+    QString filePath(const QString &key, int px) const;
+
+    const QString directory_;
+    QThreadPool renderer_;
+    mutable QMutex mutex_;
+    QHash<QString, QString> keys_;  // Icon path to key of cached renditions
+};
@@ -2,19 +2,24 @@
 
 #include "configwidget.h"
 #include "plugin.h"
+#include "searchitem.h"
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSettings>
+#include <QStandardPaths>
 #include <QUrl>
-#include <albert/icon.h>
+#include <QtConcurrentRun>
 #include <albert/logging.h>
 #include <albert/matcher.h>
-#include <albert/networkutil.h>
-#include <albert/standarditem.h>
-#include <albert/systemutil.h>
 #include <array>
+#include <map>
+#include <optional>
+#include <tuple>
 #include <vector>
 ALBERT_LOGGING_CATEGORY("websearch")
 using namespace Qt::StringLiterals;
@@ -23,16 +28,36 @@ using namespace std;
 
 namespace {
 static const auto &ENGINES_FILE_NAME  = u"engines.json"_s;
+static const auto &USAGE_FILE_NAME    = u"usage"_s;
+static const auto &HISTORY_FILE_NAME  = u"history"_s;
+static const auto &SUGGESTIONS_FILE_NAME = u"suggestions"_s;
+static const auto &ICON_CACHE_DIR_NAME = u"icons"_s;
+static const auto &BANGS_FILE_NAME    = u"bangs"_s;
+static const auto &TITLES_DIR_NAME    = u"titles"_s;
+static const int item_icon_size = 96;  // px, covers the launcher icon size at device pixel ratio 2
+static const int suggestion_budget = 150;  // msecs rankItems may wait for suggestions, debouncing included
+static const qsizetype history_limit = 3;  // Completions from the history per engine
+static const qsizetype title_limit = 5;  // Completions from the title index per engine
+static const qsizetype completion_term_length = 256;  // Longer terms are not completed by history or suggestions
+static const qsizetype pattern_query_length = 1000;  // Longer queries are not matched against patterns
 static const auto &CK_ENGINE_ID       = u"id"_s;
 static const auto &CK_ENGINE_GUID     = u"guid"_s;  // To be removed in future releases
 static const auto &CK_ENGINE_NAME     = u"name"_s;
 static const auto &CK_ENGINE_URL      = u"url"_s;
-static const auto &CK_ENGINE_TRIGGER  = u"trigger"_s;
+static const auto &CK_ENGINE_SUGGEST  = u"suggestionUrl"_s;
+static const auto &CK_ENGINE_TITLES   = u"titlesFile"_s;
+static const auto &CK_ENGINE_TRIGGER  = u"trigger"_s;  // Single trigger of former releases
+static const auto &CK_ENGINE_TRIGGERS = u"triggers"_s;
+static const auto &CK_ENGINE_PATTERN  = u"pattern"_s;
 static const auto &CK_ENGINE_ICON     = u"iconPath"_s;
 static const auto &CK_ENGINE_FALLBACK = u"fallback"_s;
+static const auto &CK_ENGINE_MEMBERS  = u"members"_s;
+static const auto &CK_ENGINE_DISABLED = u"disabled"_s;
+static const auto &CK_FALLBACK_ORDER  = u"fallback_order"_s;
+static const auto &CK_FALLBACK_LIMIT  = u"fallback_limit"_s;
 }
 
-static QByteArray serializeEngines(const vector<SearchEngine> &engines)
+static QByteArray serializeEngines(const vector<SearchEngine> &engines, const QStringList &disabled = {})
 {
     QJsonArray a;
     for (const SearchEngine& e : engines)
@@ -41,79 +66,824 @@ static QByteArray serializeEngines(const vector<SearchEngine> &engines)
         o[CK_ENGINE_ID] = e.id;
         o[CK_ENGINE_NAME] = e.name;
         o[CK_ENGINE_URL] = e.url;
-        o[CK_ENGINE_TRIGGER] = e.trigger;
+        if (!e.suggestion_url.isEmpty())
+            o[CK_ENGINE_SUGGEST] = e.suggestion_url;
+        if (!e.titles_file.isEmpty())
+            o[CK_ENGINE_TITLES] = e.titles_file;
+        o[CK_ENGINE_TRIGGERS] = QJsonArray::fromStringList(e.triggers);
+        if (!e.pattern.isEmpty())
+            o[CK_ENGINE_PATTERN] = e.pattern;
         o[CK_ENGINE_ICON] = e.icon_path;
         o[CK_ENGINE_FALLBACK] = e.fallback;
+        if (!e.members.isEmpty())
+            o[CK_ENGINE_MEMBERS] = QJsonArray::fromStringList(e.members);
         a.append(o);
     }
+    for (const auto &id : disabled)
+        a.append(QJsonObject{{CK_ENGINE_ID, id}, {CK_ENGINE_DISABLED, true}});
     return QJsonDocument(a).toJson();
 }
 
-static vector<SearchEngine> deserializeEngines(const QByteArray &json)
+static QStringList readTriggers(const QJsonObject &o)
 {
+    QStringList triggers;
+    if (o.contains(CK_ENGINE_TRIGGERS))
+        triggers = o[CK_ENGINE_TRIGGERS].toVariant().toStringList();
+    else
+        triggers << o[CK_ENGINE_TRIGGER].toString();
+
+    for (auto &t : triggers)
+        t = t.trimmed();
+    triggers.removeAll(QString());
+    triggers.removeDuplicates();
+    return triggers;
+}
+
+// Returns nullopt if json is not an array of engines, e.g. a file half written
+static optional<vector<SearchEngine>> deserializeEngines(const QByteArray &json,
+                                                         const QString &path,
+                                                         QStringList *disabled = nullptr,
+                                                         bool *migrated = nullptr)
+{
+    QJsonParseError error;
+    const auto document = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError || !document.isArray())
+    {
+        WARN << u"Invalid engines file '%1': %2"_s.arg(path, error.errorString());
+        return nullopt;
+    }
+
     vector<SearchEngine> searchEngines;
-    const auto a = QJsonDocument::fromJson(json).array();
-    for (const auto &v : a)
+    for (const auto &v : document.array())
     {
         QJsonObject o = v.toObject();
         SearchEngine e;
 
+        if (o[CK_ENGINE_DISABLED].toBool(false))
+        {
+            if (disabled)
+                *disabled << o[CK_ENGINE_ID].toString();
+            continue;
+        }
+
         // Todo remove this in future releasea
         if (o.contains(CK_ENGINE_ID))
             e.id = o[CK_ENGINE_ID].toString();
         else if (o.contains(CK_ENGINE_GUID))
             e.id = o[CK_ENGINE_GUID].toString();
 
+        // Derived, such that ids of the never rewritten system files are stable
         if (e.id.isEmpty())
-            e.id = QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
+            e.id = QString::fromLatin1(
+                QCryptographicHash::hash(QStringList{path, o[CK_ENGINE_NAME].toString(),
+                                                     o[CK_ENGINE_URL].toString()}.join(u'\n').toUtf8(),
+                                         QCryptographicHash::Sha1).toHex().left(8));
+
+        if (migrated && !o.contains(CK_ENGINE_ID))
+            *migrated = true;
 
         e.name = o[CK_ENGINE_NAME].toString();
-        e.trigger = o[CK_ENGINE_TRIGGER].toString().trimmed();
+        e.triggers = readTriggers(o);
+        e.pattern = o[CK_ENGINE_PATTERN].toString();
         e.icon_path = o[CK_ENGINE_ICON].toString();
         e.url = o[CK_ENGINE_URL].toString();
+        e.suggestion_url = o[CK_ENGINE_SUGGEST].toString();
+        e.titles_file = o[CK_ENGINE_TITLES].toString();
         // change this to false in future releases
         // For now while users configs do not have the fallback key,
         // we assume that all engines are fallbacks
         e.fallback = o[CK_ENGINE_FALLBACK].toBool(true);
+        e.members = o[CK_ENGINE_MEMBERS].toVariant().toStringList();
         searchEngines.push_back(e);
     }
     return searchEngines;
 }
 
-Plugin::Plugin()
+// Sorts by name, ties by id, such that equal sets compare equal
+static void sortEngines(vector<SearchEngine> &engines)
+{
+    sort(begin(engines), end(engines), [](const auto &a, const auto &b)
+         { return a.name < b.name || (a.name == b.name && a.id < b.id); });
+}
+
+static void sortEngines(EngineList &engines)
+{
+    sort(begin(engines), end(engines), [](const auto &a, const auto &b)
+         { return a->name < b->name || (a->name == b->name && a->id < b->id); });
+}
+
+// Compares the engines, equal pointers short-circuit
+static bool equalEngines(const EngineList &a, const EngineList &b)
+{
+    return equal(a.begin(), a.end(), b.begin(), b.end(),
+                 [](const auto &x, const auto &y){ return x == y || *x == *y; });
+}
+
+static EngineList shareEngines(vector<SearchEngine> engines)
+{
+    EngineList shared;
+    shared.reserve(engines.size());
+    for (auto &e : engines)
+        shared.emplace_back(make_shared<const SearchEngine>(::move(e)));
+    return shared;
+}
+
+// Returns the engines of lower overridden by the engines of upper with the same id,
+// without the disabled ones, and the engines of upper not in lower.
+static vector<SearchEngine> overlayEngines(vector<SearchEngine> lower,
+                                           const vector<SearchEngine> &upper,
+                                           const QStringList &disabled)
+{
+    QHash<QString, size_t> index;
+    for (size_t i = 0; i < lower.size(); ++i)
+        index.emplace(lower[i].id, i);
+
+    for (const auto &e : upper)
+        if (auto it = index.find(e.id); it != index.end())
+            lower[*it] = e;
+        else
+            lower.emplace_back(e);
+
+    lower.erase(remove_if(lower.begin(), lower.end(),
+                          [&](const auto &e){ return disabled.contains(e.id); }),
+                lower.end());
+    return lower;
+}
+
+// Returns s NFKC normalized and case folded, for caseless matching of
+// keywords in any script and normalization form. ASCII, the common case,
+// is lowercased only. If offsets is given and s is not ASCII, it receives
+// for each position of the result the position of s it stems from, plus
+// the end of the folded part of s. Left empty for ASCII, where the
+// positions are equal. If limit is not negative, folding stops at the
+// first segment boundary where the result has at least limit chars.
+static QString foldKeyword(QStringView s, vector<qsizetype> *offsets = nullptr, qsizetype limit = -1)
+{
+    // No ASCII char composes with its predecessor, hence an ASCII char
+    // following the limit bounds the folded part
+    if (limit >= 0 && limit < s.size()
+        && all_of(s.begin(), s.begin() + limit + 1, [](QChar c){ return c.unicode() < 0x80; }))
+        s = s.left(limit);
+
+    if (all_of(s.begin(), s.end(), [](QChar c){ return c.unicode() < 0x80; }))
+    {
+        QString folded(s.size(), Qt::Uninitialized);
+        auto *out = folded.data();
+        for (const auto c : s)
+            *out++ = c >= u'A' && c <= u'Z' ? QChar(c.unicode() + 0x20) : c;
+        return folded;
+    }
+
+    const auto codePoint = [s](qsizetype i, qsizetype &width) -> char32_t
+    {
+        width = 1;
+        if (s[i].isHighSurrogate() && i + 1 < s.size() && s[i + 1].isLowSurrogate())
+        {
+            width = 2;
+            return QChar::surrogateToUcs4(s[i], s[i + 1]);
+        }
+        return s[i].unicode();
+    };
+
+    // The end of the starter at i and its combining marks
+    const auto clusterEnd = [&](qsizetype i)
+    {
+        qsizetype width;
+        codePoint(i, width);
+        auto j = i + width;
+        while (j < s.size() && QChar::combiningClass(codePoint(j, width)) != 0)
+            j += width;
+        return j;
+    };
+
+    const auto nfkc = [s](qsizetype i, qsizetype j)
+    { return s.sliced(i, j - i).toString().normalized(QString::NormalizationForm_KC); };
+
+    // Segments are folded one at a time, such that every position maps to
+    // the source. A starter with its combining marks does not necessarily
+    // normalize independent of the following starters, e.g. Hangul jamo
+    // L+V+T or Indic two-part vowels compose. Hence a segment extends over
+    // the following clusters as long as normalizing them jointly differs.
+    QString folded;
+    qsizetype i = 0;
+    while (i < s.size() && (limit < 0 || folded.size() < limit))
+    {
+        auto j = clusterEnd(i);
+        auto normalized = nfkc(i, j);
+        while (j < s.size())
+        {
+            const auto k = clusterEnd(j);
+            auto joined = nfkc(i, k);
+            if (joined == normalized + nfkc(j, k))
+                break;
+            normalized = ::move(joined);
+            j = k;
+        }
+
+        const auto segment = normalized.toCaseFolded();
+        folded += segment;
+        if (offsets)
+            offsets->insert(offsets->end(), segment.size(), i);
+        i = j;
+    }
+    if (offsets)
+        offsets->push_back(i);
+    return folded;
+}
+
+// Returns the read-only engine files of the system, lowest precedence first.
+static QStringList systemEngineFiles(const QString &relative_path)
+{
+    auto dirs = QStandardPaths::standardLocations(QStandardPaths::GenericConfigLocation);
+    dirs.removeFirst();  // The writable user location
+
+    QStringList files;
+    for (auto it = dirs.crbegin(); it != dirs.crend(); ++it)
+        if (auto path = QDir(*it).filePath(relative_path); QFile::exists(path))
+            files << path;
+    return files;
+}
+
+QString Plugin::userEnginesFile() const
+{ return QDir(configLocation()).filePath(ENGINES_FILE_NAME); }
+
+bool Plugin::readEngines(QHash<QString, QByteArray> &contents,
+                         vector<SearchEngine> &system,
+                         vector<SearchEngine> &engines,
+                         bool *migrated,
+                         bool *valid) const
+{
+    // Invalid files are skipped, valid is cleared if there are any
+    if (valid)
+        *valid = true;
+
+    system.clear();
+    for (const auto &path : systemFiles_)
+        if (QFile f(path); f.open(QIODevice::ReadOnly))
+        {
+            QStringList disabled;
+            contents[path] = f.readAll();
+            if (auto layer = deserializeEngines(contents[path], path, &disabled))
+                system = overlayEngines(::move(system), ::move(*layer), disabled);
+            else if (valid)
+                *valid = false;
+        }
+
+    sortEngines(system);
+
+    QFile f(userEnginesFile());
+    if (!f.open(QIODevice::ReadOnly))
+    {
+        engines = system;
+        return false;
+    }
+
+    QStringList disabled;
+    contents[f.fileName()] = f.readAll();
+    if (auto layer = deserializeEngines(contents[f.fileName()], f.fileName(), &disabled, migrated))
+        engines = overlayEngines(system, ::move(*layer), disabled);
+    else
+    {
+        engines = system;
+        if (valid)
+            *valid = false;
+    }
+    sortEngines(engines);
+    return true;
+}
+
+Plugin::Plugin():
+    memo_(64),
+    suggestions_(QDir(dataLocation()).filePath(SUGGESTIONS_FILE_NAME))
 {
     filesystem::create_directories(dataLocation());
     filesystem::create_directories(configLocation());
 
-    QFile f(QDir(configLocation()).filePath(ENGINES_FILE_NAME));
-    if (f.open(QIODevice::ReadOnly))
-        setEngines(deserializeEngines(f.readAll()));
+    usage_ = make_unique<UsageStore>(QDir(dataLocation()).filePath(USAGE_FILE_NAME));
+    history_ = make_unique<SearchHistory>(QDir(dataLocation()).filePath(HISTORY_FILE_NAME));
+    opener_ = make_unique<UrlOpener>();
+    iconCache_ = make_unique<IconCache>(QDir(dataLocation()).filePath(ICON_CACHE_DIR_NAME));
+
+    titleBuilder_.setMaxThreadCount(1);
+
+    writeTimer_.setSingleShot(true);
+    writeTimer_.setInterval(500);
+    connect(&writeTimer_, &QTimer::timeout, this, &Plugin::writeEngines);
+
+    loadBangs();
+
+    auto s = settings();
+    fallbackOrder_ = s->value(CK_FALLBACK_ORDER).toStringList();
+    fallbackLimit_ = s->value(CK_FALLBACK_LIMIT, 0).toUInt();
+
+    // Engines are layered: system files in the XDG config dirs, overridden by
+    // the user file. The user file holds overrides, own engines and disabled ids.
+    systemFiles_ = systemEngineFiles(u"albert/%1/%2"_s.arg(id(), ENGINES_FILE_NAME));
+
+    // An empty index, setEngines skips equal engines, e.g. an empty list
+    index_ = make_shared<const Index>();
+
+    // Startup is read-only unless the user file needs a migration
+    vector<SearchEngine> engines;
+    bool migrated = false;
+    if (readEngines(persisted_, systemEngines_, engines, &migrated))
+    {
+        auto shared = shareEngines(::move(engines));
+        if (!migrated)
+            persistedEngines_ = shared;
+        setEngines(::move(shared));
+    }
     else
+    {
+        persistedEngines_ = shareEngines(systemEngines_);
         restoreDefaultEngines();
+    }
+
+    // Hot reload external changes. Watch the directory too, files replaced
+    // atomically drop out of the watcher.
+    reloadTimer_.setSingleShot(true);
+    reloadTimer_.setInterval(250);
+    connect(&reloadTimer_, &QTimer::timeout, this, &Plugin::reloadEngines);
+    watcher_.addPath(QDir(configLocation()).absolutePath());
+    for (const auto &path : QStringList(systemFiles_) << userEnginesFile())
+        if (QFile::exists(path))
+            watcher_.addPath(path);
+    connect(&watcher_, &QFileSystemWatcher::fileChanged, &reloadTimer_, qOverload<>(&QTimer::start));
+    connect(&watcher_, &QFileSystemWatcher::directoryChanged, &reloadTimer_, qOverload<>(&QTimer::start));
+}
+
+Plugin::~Plugin()
+{
+    cancelTitleBuilds_ = true;
+    titleBuilder_.clear();
+    titleBuilder_.waitForDone();
+
+    if (writeTimer_.isActive())
+        writeEngines();
+}
+
+const EngineList &Plugin::engines() const
+{ return index_->engines; }
+
+const SearchEngine *Plugin::engine(const QString &id) const
+{
+    if (auto it = index_->ids.find(id); it != index_->ids.end())
+        return index_->engines[*it].get();
+    return nullptr;
+}
+
+shared_ptr<const Plugin::Index> Plugin::index() const
+{
+    QMutexLocker l(&indexMutex_);
+    return index_;
+}
+
+void Plugin::publish(shared_ptr<const Index> index)
+{
+    {
+        QMutexLocker l(&indexMutex_);
+        index_ = ::move(index);
+    }
+
+    // Queries of former indexes bypass the memo, see matchKeywords
+    QMutexLocker l(&memoMutex_);
+    if (memoGeneration_ != index_->generation)
+    {
+        memoGeneration_ = index_->generation;
+        memo_.clear();
+    }
 }
 
-const vector<SearchEngine> &Plugin::engines() const
-{ return searchEngines_; }
+void Plugin::setEngines(EngineList engines)
+{
+    sortEngines(engines);
+    if (equalEngines(engines, index_->engines))
+        return;
+
+    // Write only if the engines differ from the persisted state. Keeps
+    // startup read-only and drops edits reverted before the write.
+    if (equalEngines(engines, persistedEngines_))
+        writeTimer_.stop();
+    else
+        writeTimer_.start();
+
+    // Compile a new index and swap it in, running queries keep the former
+    auto index = make_shared<Index>();
+    index->engines = ::move(engines);
+    buildKeywords(*index);
+    buildPatterns(*index);
+    buildFallbacks(*index);
+    publish(::move(index));
+    updateTitleIndexes();
 
-void Plugin::setEngines(vector<SearchEngine> engines)
+    QStringList icon_paths;
+    for (const auto &e : index_->engines)
+        icon_paths << e->icon_path;
+    iconCache_->update(icon_paths);
+
+    emit enginesChanged(index_->engines);
+}
+
+void Plugin::writeEngines()
 {
-    sort(begin(engines), end(engines),
-         [](auto a, auto b){ return a.name < b.name; });
+    // The user layer consists of the engines differing from the system
+    // engines and the ids of the system engines removed by the user.
+    QHash<QString, const SearchEngine*> system;
+    for (const auto &e : systemEngines_)
+        system.emplace(e.id, &e);
+
+    vector<SearchEngine> engines;
+    for (const auto &e : index_->engines)
+        if (const auto *s = system.value(e->id); !s || !(*s == *e))
+            engines.emplace_back(*e);
 
-    searchEngines_ = ::move(engines);
+    QStringList disabled;
+    for (const auto &e : systemEngines_)
+        if (!index_->ids.contains(e.id))
+            disabled << e.id;
 
-    QFile f(QDir(configLocation()).filePath(ENGINES_FILE_NAME));
+    // Skip the write if the serialization equals the content last read or written
+    const auto path = userEnginesFile();
+    auto content = serializeEngines(engines, disabled);
+    if (auto it = persisted_.constFind(path); it != persisted_.cend() && *it == content)
+    {
+        persistedEngines_ = index_->engines;
+        return;
+    }
+
+    QFile f(path);
     if (f.open(QIODevice::WriteOnly))
-        f.write(serializeEngines(searchEngines_));
+    {
+        persisted_[path] = ::move(content);
+        persistedEngines_ = index_->engines;
+        f.write(persisted_[path]);
+    }
     else
         CRIT << u"Could not write to file: '%1' %2."_s.arg(f.fileName(), f.errorString());
+}
+
+void Plugin::reloadEngines()
+{
+    for (const auto &path : QStringList(systemFiles_) << userEnginesFile())
+        if (!watcher_.files().contains(path) && QFile::exists(path))
+            watcher_.addPath(path);
+
+    QHash<QString, QByteArray> contents;
+    vector<SearchEngine> system, theirs;
+    bool valid;
+    readEngines(contents, system, theirs, nullptr, &valid);
+    if (contents == persisted_)
+        return;  // Own write or no change
+
+    // E.g. a file being written, the next change retries
+    if (!valid)
+    {
+        WARN << "Skipping the reload of invalid engine files.";
+        return;
+    }
+
+    systemEngines_ = ::move(system);
+    auto theirs_shared = shareEngines(::move(theirs));
+
+    // Three-way merge by id. Changes of one side apply. On conflicts the
+    // pending local change wins, it is written over the external change.
+    QHash<QString, shared_ptr<const SearchEngine>> base_index, their_index, our_index;
+    for (const auto &e : persistedEngines_)
+        base_index.emplace(e->id, e);
+    for (const auto &e : theirs_shared)
+        their_index.emplace(e->id, e);
+    for (const auto &e : index_->engines)
+        our_index.emplace(e->id, e);
+
+    auto changedExternally = [&](const QString &id, const shared_ptr<const SearchEngine> &t)
+    {
+        const auto b = base_index.value(id);
+        return !b || !t || !(*b == *t);
+    };
+
+    auto conflict = [](const QString &name)
+    { WARN << u"Search engine '%1' changed externally and locally, keeping the local change."_s.arg(name); };
+
+    // Unchanged engines keep their pointers
+    EngineList merged;
+    size_t changes = 0;
+    for (const auto &e : index_->engines)
+    {
+        const auto t = their_index.value(e->id);
+        const auto b = base_index.value(e->id);
+        if (!changedExternally(e->id, t))
+            merged.emplace_back(e);
+        else if (!b || !(*b == *e))
+        {
+            merged.emplace_back(e);  // New or changed locally
+            if (b || t)
+                conflict(e->name);
+        }
+        else if (t)
+        {
+            merged.emplace_back(t);
+            ++changes;
+        }
+        else
+            ++changes;  // Removed externally and unchanged locally
+    }
+    for (const auto &t : theirs_shared)
+        if (!our_index.contains(t->id) && changedExternally(t->id, t))
+        {
+            if (base_index.contains(t->id))
+                conflict(t->name);  // Removed locally
+            else
+            {
+                merged.emplace_back(t);  // New externally
+                ++changes;
+            }
+        }
+
+    persisted_ = ::move(contents);
+    persistedEngines_ = ::move(theirs_shared);
+
+    if (changes)
+    {
+        INFO << u"Applying %1 external changes to search engines."_s.arg(changes);
+        setEngines(::move(merged));
+    }
+
+    // Pending local changes may equal the external state now
+    if (equalEngines(index_->engines, persistedEngines_))
+        writeTimer_.stop();
+}
+
+void Plugin::buildKeywords(Index &index)
+{
+    for (size_t i = 0; i < index.engines.size(); ++i)
+        index.ids.emplace(index.engines[i]->id, i);
+
+    // Groups of groups are not supported
+    for (const auto &e : index.engines)
+        if (!e->members.isEmpty())
+        {
+            QStringList urls;
+            for (const auto &id : e->members)
+                if (auto it = index.ids.find(id); it != index.ids.end())
+                    if (const auto &m = *index.engines[*it]; m.members.isEmpty())
+                        urls << m.url;
+            index.groupUrls.emplace(e->id, urls);
+        }
+
+    for (size_t i = 0; i < index.engines.size(); ++i)
+    {
+        const auto &e = *index.engines[i];
+        vector<QString> S;
+        for (const auto &s : e.triggers + QStringList{e.name})
+            if (!s.isEmpty())  // Pattern engines may lack a trigger
+                S.emplace_back(foldKeyword(s));
 
-    emit enginesChanged(searchEngines_);
+        // sort shortest first (yield higher scores) (*)
+        sort(S.begin(), S.end(), [](auto &a, auto &b)
+             { return a.length() < b.length() || (a.length() == b.length() && a < b); });
+        S.erase(unique(S.begin(), S.end()), S.end());
+
+        for (const auto &s : S)
+        {
+            index.keywords.push_back({u"%1 "_s.arg(s), i});
+            index.maxKeywordLength = max(index.maxKeywordLength, index.keywords.back().keyword.size());
+        }
+    }
+
+    index.generation = ++generation_;
+}
+
+QString SearchEngine::patternError(const QString &pattern)
+{
+    QRegularExpression re(pattern);
+    if (!re.isValid())
+        return re.errorString();
+
+    // Group names are shared and group numbers shifted in the combined expression
+    for (const auto &name : re.namedCaptureGroups())
+        if (!name.isEmpty())
+            return u"Named groups are not supported."_s;
+
+    // Subroutine calls, recursion, conditions on groups
+    static const QRegularExpression group_reference(uR"(\(\?(?:[+-]?\d|R|&|P[=>]|\((?!\?)))"_s);
+    for (qsizetype i = 0; i < pattern.size(); ++i)
+        if (pattern[i] == u'\\' && i + 1 < pattern.size())
+        {
+            // Backreferences \1 to \9, \g and \k. Conservative, \1 in a class is octal.
+            if (const auto c = pattern[++i]; (u'1' <= c && c <= u'9') || c == u'g' || c == u'k')
+                return u"Backreferences are not supported."_s;
+        }
+        else if (pattern[i] == u'('
+                 && group_reference.match(pattern, i, QRegularExpression::NormalMatch,
+                                          QRegularExpression::AnchorAtOffsetMatchOption).hasMatch())
+            return u"References to groups are not supported."_s;
+
+    return {};
+}
+
+void Plugin::buildPatterns(Index &index)
+{
+    // Combine the patterns into optional lookaheads at the start of the
+    // query, each followed by an empty marker group. One match evaluates
+    // all patterns and tells which matched and what they captured. Group
+    // numbers are shifted, hence patterns referring to groups are skipped.
+    QString combined = u"\\A"_s;
+    int group = 1;
+    for (size_t i = 0; i < index.engines.size(); ++i)
+        if (const auto &e = *index.engines[i]; !e.pattern.isEmpty())
+        {
+            if (const auto error = SearchEngine::patternError(e.pattern); !error.isEmpty())
+            {
+                WARN << u"Skipping the pattern of '%1': %2"_s.arg(e.name, error);
+                continue;
+            }
+
+            // Validate as appended, such that a failure skips this engine only
+            QRegularExpression re(combined + u"(?:(?=(?:%1)\\z)())?"_s.arg(e.pattern));
+            if (!re.isValid())
+            {
+                WARN << u"Skipping the pattern of '%1': %2"_s.arg(e.name, re.errorString());
+                continue;
+            }
+
+            const auto captures = re.captureCount() - group;  // Of this pattern, without the marker
+            combined = re.pattern();
+            index.patternEngines.push_back({i, group, captures, group + captures});
+            group += captures + 1;
+        }
+
+    index.patterns.setPattern(combined);
+    if (!index.patternEngines.empty())
+        index.patterns.optimize();  // JIT compile now instead of on first use
+}
+
+void Plugin::updateTitleIndexes()
+{
+    // Indexes are built once per change of the titles file, in the background.
+    // The index file is named after the path, size and mtime of its source,
+    // hence an index is up to date iff its file exists.
+    const QDir dir(QDir(dataLocation()).filePath(TITLES_DIR_NAME));
+    dir.mkpath(u"."_s);
+
+    QHash<QString, shared_ptr<const TitleIndex>> indexes;
+    QStringList file_names;
+    for (const auto &engine : index_->engines)
+    {
+        const auto &e = *engine;
+        if (e.titles_file.isEmpty())
+            continue;
+
+        const QFileInfo source(e.titles_file);
+        const auto source_key = u"%1\n%2\n%3"_s.arg(source.absoluteFilePath())
+                                    .arg(source.size())
+                                    .arg(source.lastModified().toMSecsSinceEpoch());
+        const auto file_name = u"%1-%2.idx"_s.arg(
+            e.id, QString::fromLatin1(QCryptographicHash::hash(source_key.toUtf8(), QCryptographicHash::Sha1)
+                                          .toHex().left(16)));
+        const auto path = dir.filePath(file_name);
+        file_names << file_name;
+
+        if (QFile::exists(path))
+        {
+            auto index = titleIndex(e.id);
+            if (!index || index->path() != path)
+                index = make_shared<const TitleIndex>(path);
+            if (index->isValid())
+                indexes.emplace(e.id, ::move(index));
+        }
+        else if (!titleBuilds_.contains(path))
+        {
+            // Rechecked when done, the source may change while building
+            titleBuilds_.insert(path);
+            titleBuilder_.start([this, titles=e.titles_file, path]{
+                INFO << u"Building title index of '%1'."_s.arg(titles);
+                const bool built = TitleIndex::build(titles, path, cancelTitleBuilds_);
+                QMetaObject::invokeMethod(this, [this, path, built]{
+                    titleBuilds_.remove(path);
+                    if (built)
+                        updateTitleIndexes();
+                });
+            });
+        }
+    }
+
+    for (const auto &file_name : dir.entryList({u"*.idx"_s}, QDir::Files))
+        if (!file_names.contains(file_name))
+            dir.remove(file_name);
+
+    QMutexLocker l(&titlesMutex_);
+    titleIndexes_ = ::move(indexes);
+}
+
+shared_ptr<const TitleIndex> Plugin::titleIndex(const QString &engine_id) const
+{
+    QMutexLocker l(&titlesMutex_);
+    return titleIndexes_.value(engine_id);
+}
+
+void Plugin::buildFallbacks(Index &index) const
+{
+    QHash<QString, const SearchEngine*> fallbacks;
+    for (const auto &e : index.engines)
+        if (e->fallback)
+            fallbacks.emplace(e->id, e.get());
+
+    for (const auto &id : fallbackOrder_)
+        if (auto it = fallbacks.find(id); it != fallbacks.end())
+        {
+            index.fallbacks.emplace_back(*it);
+            fallbacks.erase(it);
+        }
+
+    index.orderedFallbackCount = index.fallbacks.size();
+
+    for (const auto &e : index.engines)  // alphabetical
+        if (fallbacks.contains(e->id))
+            index.fallbacks.emplace_back(e.get());
+}
+
+vector<const SearchEngine*> Plugin::fallbackEngines(uint limit) const
+{ return fallbackEngines(*index_, limit); }
+
+size_t Plugin::orderedFallbackCount() const
+{ return index_->orderedFallbackCount; }
+
+vector<const SearchEngine*> Plugin::fallbackEngines(const Index &index, uint limit) const
+{
+    const auto &fallbacks = index.fallbacks;
+    const size_t count = limit == 0 ? fallbacks.size() : min<size_t>(limit, fallbacks.size());
+
+    vector<const SearchEngine*> engines(fallbacks.begin(),
+                                        fallbacks.begin() + min(count, index.orderedFallbackCount));
+
+    if (engines.size() < count)
+    {
+        // Most used first, alphabetical otherwise (the unordered tail is alphabetical)
+        vector<pair<double, size_t>> unordered;
+        for (size_t i = index.orderedFallbackCount; i < fallbacks.size(); ++i)
+            unordered.emplace_back(usage_->count(fallbacks[i]->id), i);
+
+        const auto middle = unordered.begin() + (count - engines.size());
+        partial_sort(unordered.begin(), middle, unordered.end(), [](const auto &a, const auto &b)
+                     { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+
+        for (auto it = unordered.begin(); it != middle; ++it)
+            engines.emplace_back(fallbacks[it->second]);
+    }
+
+    return engines;
+}
+
+void Plugin::setFallbackOrder(const QStringList &ids)
+{
+    fallbackOrder_ = ids;
+    settings()->setValue(CK_FALLBACK_ORDER, fallbackOrder_);
+
+    auto index = make_shared<Index>(*index_);
+    index->fallbacks.clear();
+    buildFallbacks(*index);
+    publish(::move(index));
+}
+
+const IconCache &Plugin::iconCache() const
+{ return *iconCache_; }
+
+void Plugin::loadBangs()
+{
+    auto table = make_shared<const BangTable>(QDir(dataLocation()).filePath(BANGS_FILE_NAME));
+    QMutexLocker l(&bangsMutex_);
+    bangs_ = table->isValid() ? ::move(table) : nullptr;
+}
+
+shared_ptr<const BangTable> Plugin::bangs() const
+{
+    QMutexLocker l(&bangsMutex_);
+    return bangs_;
+}
+
+QFuture<uint> Plugin::importBangs(const QString &json_path)
+{
+    return QtConcurrent::run(&BangTable::compile, json_path,
+                             QDir(dataLocation()).filePath(BANGS_FILE_NAME))
+        .then(this, [this](uint count){
+            if (count)
+                loadBangs();
+            return count;
+        });
+}
+
+uint Plugin::fallbackLimit() const
+{ return fallbackLimit_.load(); }
+
+void Plugin::setFallbackLimit(uint limit)
+{
+    fallbackLimit_ = limit;
+    settings()->setValue(CK_FALLBACK_LIMIT, limit);
 }
 
 void Plugin::restoreDefaultEngines()
 {
-    vector<SearchEngine> searchEngines;
+    vector<SearchEngine> searchEngines = systemEngines_;
     QFile f(u':' + ENGINES_FILE_NAME);
     if (f.open(QIODevice::ReadOnly))
     {
@@ -124,7 +894,7 @@ void Plugin::restoreDefaultEngines()
             SearchEngine e;
             e.id = QUuid::createUuid().toString(QUuid::WithoutBraces).left(8);
             e.name = o[CK_ENGINE_NAME].toString();
-            e.trigger = o[CK_ENGINE_TRIGGER].toString();
+            e.triggers = readTriggers(o);
             e.icon_path = o[CK_ENGINE_ICON].toString();
             e.url = o[CK_ENGINE_URL].toString();
             e.fallback = o[CK_ENGINE_FALLBACK].toBool(false);
@@ -133,49 +903,180 @@ void Plugin::restoreDefaultEngines()
     }
     else
         CRIT << "Failed reading default engines.";
-    setEngines(searchEngines);
+    setEngines(shareEngines(::move(searchEngines)));
 }
 
-static shared_ptr<StandardItem> buildItem(const SearchEngine &se, const QString &search_term)
+shared_ptr<Item> Plugin::buildItem(const Index &index, const SearchEngine &se,
+                                   const shared_ptr<const SearchTerm> &term) const
 {
-    QString url = QString(se.url).replace(u"%s"_s, percentEncoded(search_term));
+    // Engines without triggers are matched by name
+    const auto &keyword = se.triggers.isEmpty() ? se.name : se.triggers.front();
+    return make_shared<SearchItem>(se.id, se.name, keyword + u' ',
+                                   iconCache_->path(se.icon_path, item_icon_size),
+                                   se.members.isEmpty() ? QStringList{se.url} : index.groupUrls.value(se.id),
+                                   term, usage_.get(), history_.get(), opener_.get());
+}
 
-    return StandardItem::make(
-        se.id,
-        se.name,
-        Plugin::tr("Search %1 for '%2'").arg(se.name, search_term),
-        [p=se.icon_path]{ return Icon::image(p); },
-        {{u"run"_s, Plugin::tr("Run websearch"), [url]{ openUrl(url); }}},
-        u"%1 %2"_s.arg(se.trigger, search_term)
-    );
+double Plugin::usageBoost(const SearchEngine &se) const
+{
+    // Saturating in [0, 0.5). Frequently used engines gain up to half of
+    // the score they miss to a perfect match.
+    const auto count = usage_->count(se.id);
+    return 0.5 * count / (count + 5.);
+}
+
+vector<Plugin::KeywordMatch> Plugin::matchKeywords(const Index &index, const QString &prefix) const
+{
+    // Matching is monotonic, a keyword not matching a prefix matches none of
+    // its extensions. Hence if no keyword longer than the prefix matches, the
+    // matches are fixed for all extensions, e.g. for "gh albert" once "gh "
+    // is typed. Such prefixes are looked up first, the shortest wins.
+    // Queries of a replaced index bypass the memo.
+    {
+        QMutexLocker l(&memoMutex_);
+        if (index.generation == memoGeneration_)
+            for (qsizetype n = 1; n <= prefix.size(); ++n)
+                if (const auto *memo = memo_.object(prefix.left(n));
+                    memo && (memo->fixed || n == prefix.size()))
+                    return memo->matches;
+    }
+
+    // Keywords share the matcher of prefixes of equal length
+    auto memo = make_unique<Memo>(Memo{{}, true});
+    map<qsizetype, unique_ptr<Matcher>> matchers;
+    for (const auto &k : index.keywords)
+    {
+        // max one match per engine, assumption: following cant yield higher scores (*)
+        if (!memo->matches.empty() && memo->matches.back().engine == k.engine)
+            continue;
+
+        const auto length = min(prefix.size(), k.keyword.size());
+        auto &matcher = matchers[length];
+        if (!matcher)
+            matcher.reset(new Matcher(prefix.left(length), {}));
+        if (Match m = matcher->match(k.keyword))
+        {
+            memo->matches.push_back({k.engine, length, m.score()});
+            memo->fixed = memo->fixed && k.keyword.size() <= prefix.size();
+        }
+    }
+
+    auto result = memo->matches;
+    QMutexLocker l(&memoMutex_);
+    if (index.generation == memoGeneration_)
+        memo_.insert(prefix, memo.release());
+    return result;
 }
 
 vector<RankItem> Plugin::rankItems(QueryContext &ctx)
 {
     vector<RankItem> results;
+    vector<tuple<const SearchEngine*, QString, double, QStringList, shared_ptr<SuggestionProvider::Request>>> pending;
+
+    const auto query = ctx.query();
+    const auto index = this->index();  // one snapshot for the whole query
 
-    for (const SearchEngine &e: searchEngines_)
+    // Bangs, e.g. "!w foo". The trigger ends at the first space.
+    if (query.startsWith(u'!'))
+        if (const auto table = bangs())
+        {
+            const auto head = QStringView(query).left(BangTable::max_trigger_length + 2);
+            const auto space = head.indexOf(u' ');
+            const auto trigger = head.sliced(1, (space < 0 ? head.size() : space) - 1);
+            if (auto bang = table->lookup(trigger))
+                results.emplace_back(
+                    make_shared<SearchItem>(u"!%1"_s.arg(trigger.toString().toLower()), bang->name,
+                                            u"!%1 "_s.arg(trigger), iconCache_->path(u":default"_s, item_icon_size),
+                                            QStringList{bang->url},
+                                            make_shared<const SearchTerm>(space < 0 ? QString() : query.mid(space + 1)),
+                                            usage_.get(), history_.get(), opener_.get()),
+                    1.0);
+        }
+
+    // Pattern engines. A single match of the combined expression for all of them.
+    if (!index->patternEngines.empty() && !query.isEmpty() && query.size() <= pattern_query_length)
+        if (const auto m = index->patterns.match(query); m.hasMatch())
+        {
+            const auto term = make_shared<const SearchTerm>(query);
+            for (const auto &p : index->patternEngines)
+                if (m.capturedStart(p.marker) >= 0)
+                {
+                    const auto &e = *index->engines[p.engine];
+                    QStringList urls = e.members.isEmpty() ? QStringList{e.url} : index->groupUrls.value(e.id);
+                    for (auto &url : urls)
+                        for (int g = 0; g <= p.groups && url.contains(u"%{"_s); ++g)
+                            url.replace(u"%{%1}"_s.arg(g),
+                                        SearchTerm(g ? m.captured(p.first_group + g - 1) : query).percentEncoded());
+                    results.emplace_back(
+                        make_shared<SearchItem>(e.id, e.name, QString(),  // The term is the whole query
+                                                iconCache_->path(e.icon_path, item_icon_size),
+                                                ::move(urls), term,
+                                                usage_.get(), history_.get(), opener_.get()),
+                        1.0);
+                }
+        }
+
+    // Matches depend on the first maxKeywordLength folded chars only.
+    // Memoize them such that incremental typing of the search term skips
+    // matching. Engines matching prefixes of the same length share the
+    // encoded term. Fold only as far as needed, pasted text may be
+    // arbitrarily long. Normalization may compose several chars into one,
+    // e.g. Hangul jamo or Greek with three diacritics, hence no fixed slice.
+    vector<qsizetype> offsets;
+    auto prefix = foldKeyword(query, &offsets, index->maxKeywordLength);
+    prefix.truncate(index->maxKeywordLength);
+
+    QHash<qsizetype, shared_ptr<const SearchTerm>> terms;
+    for (const auto &match : matchKeywords(*index, prefix))
     {
-        vector<QString> S{ e.trigger, e.name };
+        const auto &e = *index->engines[match.engine];
+        auto &term = terms[match.prefix_length];
+        if (!term)
+            term = make_shared<const SearchTerm>(
+                query.mid(offsets.empty() ? match.prefix_length : offsets[match.prefix_length]));
+        const auto score = match.score + (1 - match.score) * usageBoost(e);
+        results.emplace_back(buildItem(*index, e, term), score);
 
-        // sort shortest first (yield higher scores) (*)
-        sort(S.begin(), S.end(), [](auto &a, auto &b){ return a.length() < b.length(); });
+        if (term->raw().size() > completion_term_length || QStringView(term->raw()).trimmed().isEmpty())
+            continue;
 
-        for (const auto &s : S)
+        // Previously searched terms starting with the term, most recent first
+        auto offered = history_->complete(e.id, term->raw(), history_limit);
+        offered.removeIf([&](const auto &h){ return h.compare(term->raw(), Qt::CaseInsensitive) == 0; });
+        for (qsizetype i = 0; i < offered.size(); ++i)
+            results.emplace_back(buildItem(*index, e, make_shared<const SearchTerm>(offered[i])),
+                                 score * (0.95 - 0.01 * i));
+
+        // Titles of the local dataset starting with the term
+        if (const auto titles = titleIndex(e.id))
         {
-            auto keyword = u"%1 "_s.arg(s.toLower());
-            auto prefix = ctx.query().toLower().left(keyword.size());
-            Matcher matcher(prefix, {});
-            Match m = matcher.match(keyword);
-            if (m)
-            {
-                results.emplace_back(buildItem(e, ctx.query().mid(prefix.size())), m);
-                // max one of these icons, assumption: following cant yield higher scores (*)
-                break;
-            }
+            int i = 0;
+            for (const auto &title : titles->complete(term->raw(), title_limit))
+                if (title.compare(term->raw(), Qt::CaseInsensitive) != 0
+                    && !offered.contains(title, Qt::CaseInsensitive))
+                {
+                    results.emplace_back(buildItem(*index, e, make_shared<const SearchTerm>(title)),
+                                         score * (0.92 - 0.01 * i++));
+                    offered << title;
+                }
         }
+
+        if (!e.suggestion_url.isEmpty())
+            pending.emplace_back(&e, term->raw(), score, offered,
+                                 suggestions_.request(e.id, e.suggestion_url, term->raw()));
     }
 
+    // Never block longer than the budget, stop waiting once the query is
+    // replaced by the next keystroke. Late suggestions are cached.
+    QDeadlineTimer deadline(suggestion_budget);
+    for (const auto &[e, search_term, score, offered, request] : pending)
+    {
+        const auto suggestions = suggestions_.result(request, deadline, [&ctx]{ return ctx.isValid(); });
+        for (int i = 0; i < suggestions.size(); ++i)
+            if (suggestions[i] != search_term && !offered.contains(suggestions[i], Qt::CaseInsensitive))
+                results.emplace_back(buildItem(*index, *e, make_shared<const SearchTerm>(suggestions[i])),
+                                     score * (0.9 - 0.01 * min(i, 50)));
+    }
 
     return results;
 }
@@ -184,9 +1085,12 @@ vector<shared_ptr<Item>> Plugin::fallbacks(const QString &query) const
 {
     vector<shared_ptr<Item>> results;
     if (!query.isEmpty())
-        for (const SearchEngine &e: searchEngines_)
-            if (e.fallback)
-                results.emplace_back(buildItem(e, query.isEmpty() ? u"…"_s : query));
+    {
+        const auto index = this->index();
+        const auto term = make_shared<const SearchTerm>(query);
+        for (const SearchEngine *e : fallbackEngines(*index, fallbackLimit_))
+            results.emplace_back(buildItem(*index, *e, term));
+    }
     return results;
 }
 
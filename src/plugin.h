@@ -1,21 +1,61 @@
 // Copyright (c) 2022-2024 Manuel Schneider
 
 #pragma once
+#include "bangtable.h"
+#include "iconcache.h"
+#include "searchhistory.h"
+#include "searchterm.h"
+#include "suggestionprovider.h"
+#include "titleindex.h"
+#include "urlopener.h"
+#include "usagestore.h"
+#include <QCache>
+#include <QFileSystemWatcher>
+#include <QFuture>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
 #include <albert/extensionplugin.h>
 #include <albert/fallbackhandler.h>
 #include <albert/globalqueryhandler.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 struct SearchEngine
 {
     QString id;
     QString name;
-    QString trigger;
+    QStringList triggers;  // Aliases, e.g. gh, git, github
+    QString pattern;  // Regular expression matching whole queries, optional
     QString icon_path;
     QString url;
+    QString suggestion_url;  // OpenSearch suggestions, optional
+    QString titles_file;  // Local titles for completions, one per line, optional
     bool fallback;
+    QStringList members;  // Ids of the engines of a group, empty for regular engines
+
+    bool operator==(const SearchEngine &o) const
+    {
+        return id == o.id && name == o.name && triggers == o.triggers
+               && pattern == o.pattern && icon_path == o.icon_path && url == o.url
+               && suggestion_url == o.suggestion_url && titles_file == o.titles_file
+               && fallback == o.fallback && members == o.members;
+    }
+
+    /// Returns why pattern can not be combined with the patterns of other
+    /// engines, e.g. since it refers to groups by number or name. Empty if
+    /// it can.
+    static QString patternError(const QString &pattern);
 };
 
+/// Immutable engines shared by the engine list, its copies and the undo history.
+using EngineList = std::vector<std::shared_ptr<const SearchEngine>>;
+
 class Plugin : public albert::ExtensionPlugin,
                public albert::GlobalQueryHandler,
                public albert::FallbackHandler
@@ -25,18 +65,134 @@ class Plugin : public albert::ExtensionPlugin,
 
 public:
     Plugin();
-    const std::vector<SearchEngine>& engines() const;
-    void setEngines(std::vector<SearchEngine> engines);
+    ~Plugin() override;
+    /// GUI thread only, as all of the engine list accessors and mutators.
+    const EngineList &engines() const;
+    const SearchEngine *engine(const QString &id) const;
+
+    /// Replaces the engines. Unchanged engines of a copy of engines() keep
+    /// their pointers, which makes restoring a former list a pointer swap.
+    void setEngines(EngineList engines);
     void restoreDefaultEngines();
 
+    /// Returns the fallback engines in the order they are returned as fallbacks.
+    /// Engines with a user-defined position come first, the rest is sorted by usage.
+    /// GUI thread only, the pointers are valid until the engines change.
+    std::vector<const SearchEngine*> fallbackEngines(uint limit = 0) const;
+    /// Returns the number of fallback engines with a user-defined position. GUI thread only.
+    size_t orderedFallbackCount() const;
+    void setFallbackOrder(const QStringList &ids);
+    uint fallbackLimit() const;
+    void setFallbackLimit(uint);
+
+    const IconCache &iconCache() const;
+
+    /// Compiles a bang dataset in the background and loads it when done.
+    /// The future holds the number of imported bangs, 0 on failure.
+    QFuture<uint> importBangs(const QString &json_path);
+
 private:
+    struct Keyword
+    {
+        QString keyword;  // NFKC normalized and case folded, with trailing space
+        size_t engine;
+    };
+
+    struct KeywordMatch
+    {
+        size_t engine;
+        qsizetype prefix_length;
+        double score;
+    };
+
+    struct Memo
+    {
+        std::vector<KeywordMatch> matches;
+        bool fixed;  // The matches of all extensions of the prefix
+    };
+
+    struct PatternEngine
+    {
+        size_t engine;
+        int first_group;  // Of the capture groups of the pattern in the combined expression
+        int groups;
+        int marker;  // Group captured iff the pattern matches
+    };
+
+    ///
+    /// The engines compiled for queries. Immutable once published, queries
+    /// take the current one when they start and keep it until they finish.
+    ///
+    struct Index
+    {
+        EngineList engines;
+        QHash<QString, size_t> ids;
+        QHash<QString, QStringList> groupUrls;  // Group id to member url templates
+        std::vector<Keyword> keywords;  // Grouped by engine, shortest first
+        qsizetype maxKeywordLength{0};
+        quint64 generation{0};  // Of the keywords, memoized matches refer to one
+        QRegularExpression patterns;  // All patterns, combined into one expression
+        std::vector<PatternEngine> patternEngines;
+        std::vector<const SearchEngine*> fallbacks;  // Ordered ones first, the rest alphabetically
+        size_t orderedFallbackCount{0};
+    };
+
     std::vector<albert::RankItem> rankItems(albert::QueryContext &) override;
     std::vector<std::shared_ptr<albert::Item>> fallbacks(const QString &) const override;
     QWidget *buildConfigWidget() override;
+    std::shared_ptr<albert::Item> buildItem(const Index &, const SearchEngine &,
+                                            const std::shared_ptr<const SearchTerm> &) const;
+    double usageBoost(const SearchEngine &) const;
+    std::vector<const SearchEngine*> fallbackEngines(const Index &, uint limit) const;
+    void buildFallbacks(Index &) const;
+    void buildKeywords(Index &);
+    static void buildPatterns(Index &);
+    void publish(std::shared_ptr<const Index>);
+    std::shared_ptr<const Index> index() const;
+    void updateTitleIndexes();
+    std::shared_ptr<const TitleIndex> titleIndex(const QString &engine_id) const;
+    QString userEnginesFile() const;
+    bool readEngines(QHash<QString, QByteArray> &contents,
+                     std::vector<SearchEngine> &system,
+                     std::vector<SearchEngine> &engines,
+                     bool *migrated = nullptr,
+                     bool *valid = nullptr) const;
+    void writeEngines();
+    void reloadEngines();
+    void loadBangs();
+    std::shared_ptr<const BangTable> bangs() const;
+    std::vector<KeywordMatch> matchKeywords(const Index &, const QString &prefix) const;
 
-    std::vector<SearchEngine> searchEngines_;
+    // Written on the GUI thread only, which hence reads it without locking
+    std::shared_ptr<const Index> index_;
+    mutable QMutex indexMutex_;
+    quint64 generation_{0};  // Of the last keywords built
+    mutable QMutex memoMutex_;
+    mutable QCache<QString, Memo> memo_;  // Folded query prefix to matches
+    quint64 memoGeneration_{0};  // Of the index the memo refers to, guarded by memoMutex_
+    QStringList fallbackOrder_;
+    std::atomic<uint> fallbackLimit_{0};
+    std::unique_ptr<UsageStore> usage_;
+    std::unique_ptr<SearchHistory> history_;
+    std::unique_ptr<UrlOpener> opener_;
+    std::unique_ptr<IconCache> iconCache_;
+    QTimer writeTimer_;  // Debounces writes of the engines file
+    QTimer reloadTimer_;  // Debounces external changes of the engines file
+    QFileSystemWatcher watcher_;
+    QStringList systemFiles_;  // Read-only engine files, lowest precedence first
+    std::vector<SearchEngine> systemEngines_;  // Merged engines of the system files
+    QHash<QString, QByteArray> persisted_;  // Content of the engine files as last read or written
+    EngineList persistedEngines_;  // Merged engines of persisted_
+    SuggestionProvider suggestions_;
+    mutable QMutex bangsMutex_;
+    std::shared_ptr<const BangTable> bangs_;  // Replaced on import, shared with running queries
+    mutable QMutex titlesMutex_;
+    QHash<QString, std::shared_ptr<const TitleIndex>> titleIndexes_;  // Engine id to title index
+    QSet<QString> titleBuilds_;  // Index files being built
+    std::atomic_bool cancelTitleBuilds_{false};
+    QThreadPool titleBuilder_;
 
 signals:
-    void enginesChanged(const std::vector<SearchEngine> &engines);
+    void enginesChanged(const EngineList &engines);
 
 };
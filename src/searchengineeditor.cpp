@@ -2,39 +2,78 @@
 
 #include "searchengineeditor.h"
 #include <QApplication>
+#include <QBuffer>
 #include <QDragEnterEvent>
 #include <QDropEvent>
 #include <QFileDialog>
+#include <QImageReader>
 #include <QMimeData>
 #include <QMimeDatabase>
 #include <QStandardPaths>
+#include <QPushButton>
+#include <QRegularExpression>
 #include <QToolButton>
 #include <QUrl>
+#include <QtConcurrentRun>
 #include <albert/messagebox.h>
 using namespace Qt::StringLiterals;
 using namespace albert;
 
-SearchEngineEditor::SearchEngineEditor(const QString &icon_url,
-                                       const QString &name,
-                                       const QString &trigger,
-                                       const QString &url,
-                                       bool fallback,
-                                       QWidget *parent) : QDialog(parent)
+static const int icon_size = 256;
+
+static QByteArray encodeIcon(QImage image)
+{
+    if (image.isNull())
+        return {};
+
+    if (image.size() != image.size().scaled(icon_size, icon_size, Qt::KeepAspectRatio))
+        image = image.scaled(icon_size, icon_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return png;
+}
+
+QByteArray SearchEngineEditor::readIcon(const QString &file_name)
+{
+    // Let the decoder scale, large images are never decoded in full size
+    QImageReader reader(file_name);
+    if (const auto size = reader.size(); size.isValid())
+        reader.setScaledSize(size.scaled(icon_size, icon_size, Qt::KeepAspectRatio));
+    return encodeIcon(reader.read());
+}
+
+SearchEngineEditor::SearchEngineEditor(const SearchEngine &engine,
+                                       const std::vector<SearchEngine> &candidates,
+                                       QWidget *parent) : QDialog(parent), engine_(engine)
 {
     ui.setupUi(this);
     setWindowModality(Qt::WindowModal);
 
     ui.label_iconhint->setForegroundRole(QPalette::PlaceholderText);
 
-    if (QUrl qurl(icon_url); qurl.isLocalFile())
+    if (QUrl qurl(engine.icon_path); qurl.isLocalFile())
         ui.toolButton_icon->setIcon(QIcon(qurl.toLocalFile()));
     else
-        ui.toolButton_icon->setIcon(QIcon(icon_url));
+        ui.toolButton_icon->setIcon(QIcon(engine.icon_path));
+    icon_ = ui.toolButton_icon->icon();
     ui.toolButton_icon->setAcceptDrops(true);
-    ui.lineEdit_name->setText(name);
-    ui.lineEdit_trigger->setText(trigger);
-    ui.lineEdit_url->setText(url);
-    ui.checkBox_fallback->setChecked(fallback);
+    ui.lineEdit_name->setText(engine.name);
+    ui.lineEdit_trigger->setText(engine.triggers.join(u", "_s));
+    ui.lineEdit_pattern->setText(engine.pattern);
+    ui.lineEdit_url->setText(engine.url);
+    ui.lineEdit_suggestionUrl->setText(engine.suggestion_url);
+    ui.lineEdit_titlesFile->setText(engine.titles_file);
+    ui.checkBox_fallback->setChecked(engine.fallback);
+
+    for (const auto &e : candidates)
+    {
+        auto *item = new QListWidgetItem(e.name, ui.listWidget_members);
+        item->setData(Qt::UserRole, e.id);
+        item->setCheckState(engine.members.contains(e.id) ? Qt::Checked : Qt::Unchecked);
+    }
 
     connect(ui.toolButton_icon, &QToolButton::clicked, this, [this](){
 
@@ -48,27 +87,47 @@ SearchEngineEditor::SearchEngineEditor(const QString &icon_url,
         if (fileName.isEmpty())
             return;
 
-        icon_image = std::make_unique<QImage>(fileName);
-        ui.toolButton_icon->setIcon(QIcon(fileName));
+        importIcon(QtConcurrent::run(&SearchEngineEditor::readIcon, fileName));
+    });
+
+    connect(&icon_watcher_, &QFutureWatcher<QByteArray>::finished, this, [this]{
+        ui.buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
+        QPixmap pixmap;
+        if (auto png = icon_watcher_.result(); pixmap.loadFromData(png, "PNG"))
+        {
+            icon_png = png;
+            icon_ = QIcon(pixmap);
+        }
+        else
+            warning(tr("Could not read the image."));
+        ui.toolButton_icon->setIcon(icon_);
     });
 
     connect(ui.lineEdit_name, &QLineEdit::editingFinished, this,
             [&]() { ui.lineEdit_name->setText(ui.lineEdit_name->text().trimmed()); });
 
     connect(ui.lineEdit_trigger, &QLineEdit::editingFinished, this,
-            [&]() { ui.lineEdit_trigger->setText(ui.lineEdit_trigger->text().trimmed()); });
+            [&]() { ui.lineEdit_trigger->setText(triggers().join(u", "_s)); });
 
     connect(ui.lineEdit_url, &QLineEdit::editingFinished, this,
             [&]() { ui.lineEdit_url->setText(ui.lineEdit_url->text().trimmed()); });
 
+    connect(ui.lineEdit_suggestionUrl, &QLineEdit::editingFinished, this,
+            [&]() { ui.lineEdit_suggestionUrl->setText(ui.lineEdit_suggestionUrl->text().trimmed()); });
+
+    connect(ui.lineEdit_titlesFile, &QLineEdit::editingFinished, this,
+            [&]() { ui.lineEdit_titlesFile->setText(ui.lineEdit_titlesFile->text().trimmed()); });
+
     disconnect(ui.buttonBox, &QDialogButtonBox::accepted,
                this, &QDialog::accept);
 
     connect(ui.buttonBox, &QDialogButtonBox::accepted, this, [this]() {
         if (ui.lineEdit_name->text().isEmpty()
-            || ui.lineEdit_trigger->text().isEmpty()
-            || ui.lineEdit_url->text().isEmpty())
+            || (triggers().isEmpty() && ui.lineEdit_pattern->text().isEmpty())
+            || (ui.lineEdit_url->text().isEmpty() && members().isEmpty()))
             warning(u"None of the fields must be empty."_s);
+        else if (const auto error = SearchEngine::patternError(ui.lineEdit_pattern->text()); !error.isEmpty())
+            warning(tr("Invalid pattern: %1").arg(error));
         else
             accept();
     });
@@ -76,17 +135,48 @@ SearchEngineEditor::SearchEngineEditor(const QString &icon_url,
     ui.toolButton_icon->installEventFilter(this);
 }
 
-QString SearchEngineEditor::name() const
-{ return ui.lineEdit_name->text(); }
+QStringList SearchEngineEditor::splitTriggers(const QString &text)
+{
+    QStringList triggers;
+    for (const auto &t : text.split(u','))
+        if (const auto trimmed = t.trimmed(); !trimmed.isEmpty() && !triggers.contains(trimmed))
+            triggers << trimmed;
+    return triggers;
+}
+
+QStringList SearchEngineEditor::triggers() const
+{ return splitTriggers(ui.lineEdit_trigger->text()); }
 
-QString SearchEngineEditor::trigger() const
-{ return ui.lineEdit_trigger->text(); }
+QStringList SearchEngineEditor::members() const
+{
+    QStringList ids;
+    for (int i = 0; i < ui.listWidget_members->count(); ++i)
+        if (auto *item = ui.listWidget_members->item(i); item->checkState() == Qt::Checked)
+            ids << item->data(Qt::UserRole).toString();
+    return ids;
+}
 
-QString SearchEngineEditor::url() const
-{ return ui.lineEdit_url->text(); }
+SearchEngine SearchEngineEditor::searchEngine() const
+{
+    auto engine = engine_;
+    engine.name = ui.lineEdit_name->text();
+    engine.triggers = triggers();
+    engine.pattern = ui.lineEdit_pattern->text();
+    engine.url = ui.lineEdit_url->text();
+    engine.suggestion_url = ui.lineEdit_suggestionUrl->text();
+    engine.titles_file = ui.lineEdit_titlesFile->text();
+    engine.fallback = ui.checkBox_fallback->isChecked();
+    engine.members = members();
+    return engine;
+}
 
-bool SearchEngineEditor::fallback() const
-{ return ui.checkBox_fallback->isChecked(); }
+void SearchEngineEditor::importIcon(QFuture<QByteArray> png)
+{
+    // Placeholder until decoded, accepting has to wait for the result
+    ui.toolButton_icon->setIcon(QIcon::fromTheme(u"image-loading"_s));
+    ui.buttonBox->button(QDialogButtonBox::Ok)->setEnabled(false);
+    icon_watcher_.setFuture(png);
+}
 
 bool SearchEngineEditor::eventFilter(QObject *watched, QEvent *event)
 {
@@ -115,8 +205,8 @@ bool SearchEngineEditor::eventFilter(QObject *watched, QEvent *event)
             auto *e = static_cast<QDropEvent*>(event);
             if (e->proposedAction() == Qt::CopyAction){
                 if (e->mimeData()->hasImage()){
-                    icon_image = std::make_unique<QImage>(qvariant_cast<QImage>(e->mimeData()->imageData()));
-                    ui.toolButton_icon->setIcon(QIcon(QPixmap::fromImage(*icon_image)));
+                    importIcon(QtConcurrent::run(encodeIcon,
+                                                 qvariant_cast<QImage>(e->mimeData()->imageData())));
                     e->acceptProposedAction();
                     return true;
                 } else if (e->mimeData()->hasUrls()) {
@@ -124,8 +214,7 @@ bool SearchEngineEditor::eventFilter(QObject *watched, QEvent *event)
                     for (const QUrl &url : e->mimeData()->urls()) {
                         if (url.isLocalFile()
                             && db.mimeTypeForUrl(url).name().startsWith(u"image/"_s)){
-                            icon_image = std::make_unique<QImage>(url.toLocalFile());
-                            ui.toolButton_icon->setIcon(QIcon(QPixmap::fromImage(*icon_image)));
+                            importIcon(QtConcurrent::run(&SearchEngineEditor::readIcon, url.toLocalFile()));
                             e->acceptProposedAction();
                             return true;
                         }
@@ -1,28 +1,39 @@
 // Copyright (C) 2014-2021 Manuel Schneider
 
 #pragma once
+#include "plugin.h"
 #include "ui_searchengineeditor.h"
 #include <QDialog>
-#include <QImage>
+#include <QFutureWatcher>
+#include <QIcon>
 
 class SearchEngineEditor : public QDialog
 {
     Q_OBJECT
 public:
-    explicit SearchEngineEditor(const QString &icon_url,
-                                const QString &name,
-                                const QString &trigger,
-                                const QString &url,
-                                bool fallback,
+    explicit SearchEngineEditor(const SearchEngine &engine,
+                                const std::vector<SearchEngine> &candidates,
                                 QWidget *parent);
 
-    std::unique_ptr<QImage> icon_image;
-    QString name() const;
-    QString trigger() const;
-    QString url() const;
-    bool fallback() const;
+    QByteArray icon_png;  // The new icon, PNG encoded and scaled to 256 px, empty if unchanged
+
+    /// Returns the image file PNG encoded and scaled to icon size, empty on failure.
+    static QByteArray readIcon(const QString &file_name);
+
+    /// Returns the comma separated triggers in text, trimmed, without empty ones.
+    static QStringList splitTriggers(const QString &text);
+
+    /// Returns the edited engine. The icon path is the one passed, see icon_png.
+    SearchEngine searchEngine() const;
 
 private:
+    QStringList triggers() const;
+    QStringList members() const;
+
+    SearchEngine engine_;
     Ui::SearchEngineEditor ui;
+    QFutureWatcher<QByteArray> icon_watcher_;
+    QIcon icon_;
+    void importIcon(QFuture<QByteArray> png);
     bool eventFilter(QObject *watched, QEvent *event) override;
 };
@@ -0,0 +1,123 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "searchhistory.h"
+#include <QDateTime>
+#include <QtConcurrentRun>
+#include <algorithm>
+using namespace std;
+
+// Record format: <msecs since epoch>\t<engine id>\t<term>
+
+static const qsizetype max_term_length = 1000;  // Longer terms are not recorded
+static const size_t scan_limit = 1000;  // Prefix matches ranked by recency, bounds lookups
+
+SearchHistory::SearchHistory(const QString &path) : log_(path) {}
+
+SearchHistory::~SearchHistory()
+{ loader_.waitForFinished(); }
+
+void SearchHistory::insert(Index &index, const QString &engine_id, const QString &term, qint64 timestamp)
+{
+    auto &entries = index[engine_id];
+    auto key = term.toCaseFolded();
+    auto it = lower_bound(entries.begin(), entries.end(), key,
+                          [](const Entry &e, const QString &k){ return e.key < k; });
+    if (it == entries.end() || it->key != key)
+        entries.insert(it, {::move(key), term, timestamp});
+    else if (it->timestamp <= timestamp)
+        *it = {::move(key), term, timestamp};
+}
+
+void SearchHistory::load()
+{
+    Index index;
+    qsizetype records = 0;
+    for (const auto &record : log_.read())
+        if (const auto fields = record.split('\t'); fields.size() == 3)
+        {
+            const auto term = QString::fromUtf8(fields[2]);
+            index[QString::fromUtf8(fields[1])].push_back({term.toCaseFolded(), term, fields[0].toLongLong()});
+            ++records;
+        }
+
+    // Sort once instead of inserting each record, keep the latest of equal keys
+    qsizetype entries = 0;
+    for (auto &v : index)
+    {
+        sort(v.begin(), v.end(), [](const Entry &a, const Entry &b)
+             { return a.key < b.key || (a.key == b.key && a.timestamp > b.timestamp); });
+        v.erase(unique(v.begin(), v.end(), [](const Entry &a, const Entry &b){ return a.key == b.key; }),
+                v.end());
+        entries += v.size();
+    }
+
+    QMutexLocker l(&mutex_);
+    for (const auto &[engine_id, term, timestamp] : unindexed_)
+        insert(index, engine_id, term, timestamp);
+    unindexed_ = {};
+    index_ = ::move(index);
+    loaded_ = true;
+
+    // Compact the log if it consists mostly of repeated searches. Under the
+    // lock, such that no record gets lost between reading and rewriting.
+    if (records > 2 * entries + 64)
+    {
+        QList<QByteArray> compacted;
+        for (auto it = index_.cbegin(); it != index_.cend(); ++it)
+            for (const auto &e : it.value())
+                compacted.emplace_back(QByteArray::number(e.timestamp) + '\t'
+                                       + it.key().toUtf8() + '\t' + e.term.toUtf8());
+        log_.rewrite(::move(compacted));
+    }
+}
+
+void SearchHistory::record(const QString &engine_id, const QString &term)
+{
+    // Also replaces tabs and newlines, the separators of the log
+    const auto simplified = term.simplified();
+    if (simplified.isEmpty() || simplified.size() > max_term_length)
+        return;
+
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker l(&mutex_);
+    if (loaded_)
+        insert(index_, engine_id, simplified, now);
+    else
+        unindexed_.emplace_back(engine_id, simplified, now);
+    log_.append(QByteArray::number(now) + '\t' + engine_id.toUtf8() + '\t' + simplified.toUtf8());
+}
+
+QStringList SearchHistory::complete(const QString &engine_id, const QString &prefix, qsizetype limit)
+{
+    QMutexLocker l(&mutex_);
+    if (!loaded_)
+    {
+        if (!loading_)
+        {
+            loading_ = true;
+            loader_ = QtConcurrent::run([this]{ load(); });
+        }
+        return {};
+    }
+
+    const auto key = prefix.simplified().toCaseFolded();
+    const auto it = index_.constFind(engine_id);
+    if (key.isEmpty() || it == index_.cend())
+        return {};
+
+    // Entries starting with key are contiguous
+    vector<const Entry*> matches;
+    for (auto e = lower_bound(it->cbegin(), it->cend(), key,
+                              [](const Entry &x, const QString &k){ return x.key < k; });
+         e != it->cend() && e->key.startsWith(key) && matches.size() < scan_limit; ++e)
+        matches.emplace_back(&*e);
+
+    const auto middle = matches.begin() + min<qsizetype>(limit, matches.size());
+    partial_sort(matches.begin(), middle, matches.end(),
+                 [](const Entry *a, const Entry *b){ return a->timestamp > b->timestamp; });
+
+    QStringList terms;
+    for (auto m = matches.begin(); m != middle; ++m)
+        terms << (*m)->term;
+    return terms;
+}
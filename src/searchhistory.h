@@ -0,0 +1,54 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "appendlog.h"
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <tuple>
+#include <vector>
+
+///
+/// Persistent history of executed searches.
+///
+/// Backed by an append-only log that is loaded in the background on first
+/// use. Terms are kept per engine, sorted by case folded term, such that
+/// completions of a prefix are a binary search and a short scan away.
+/// Thread-safe.
+///
+class SearchHistory
+{
+public:
+    explicit SearchHistory(const QString &path);
+    ~SearchHistory();
+
+    /// Records a search of term using the engine with the given id.
+    void record(const QString &engine_id, const QString &term);
+
+    /// Returns up to limit terms searched using the engine with the given
+    /// id that start with prefix, case-insensitive, most recent first.
+    /// Empty until loaded.
+    QStringList complete(const QString &engine_id, const QString &prefix, qsizetype limit);
+
+private:
+    struct Entry
+    {
+        QString key;  // Case folded term
+        QString term;
+        qint64 timestamp;
+    };
+
+    using Index = QHash<QString, std::vector<Entry>>;  // Engine id to entries sorted by key
+
+    static void insert(Index &index, const QString &engine_id, const QString &term, qint64 timestamp);
+    void load();
+
+    AppendLog log_;
+    QMutex mutex_;
+    QFuture<void> loader_;
+    Index index_;
+    std::vector<std::tuple<QString, QString, qint64>> unindexed_;  // Recorded while loading
+    bool loading_ = false;
+    bool loaded_ = false;
+};
@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "plugin.h"
+#include "searchhistory.h"
+#include "searchitem.h"
+#include "urlopener.h"
+#include "usagestore.h"
+#include <albert/icon.h>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+static const qsizetype subtext_term_length = 100;  // chars of the term shown in the subtext
+
+SearchItem::SearchItem(const QString &engine_id,
+                       const QString &name,
+                       const QString &input_prefix,
+                       const QString &icon_path,
+                       QStringList url_templates,
+                       shared_ptr<const SearchTerm> term,
+                       UsageStore *usage,
+                       SearchHistory *history,
+                       UrlOpener *opener):
+    engine_id_(engine_id),
+    name_(name),
+    input_prefix_(input_prefix),
+    icon_path_(icon_path),
+    url_templates_(::move(url_templates)),
+    term_(::move(term)),
+    usage_(usage),
+    history_(history),
+    opener_(opener)
+{}
+
+QString SearchItem::id() const
+{ return engine_id_; }
+
+QString SearchItem::text() const
+{ return name_; }
+
+QString SearchItem::subtext() const
+{
+    const auto &raw = term_->raw();
+    if (raw.size() <= subtext_term_length)
+        return Plugin::tr("Search %1 for '%2'").arg(name_, raw);
+
+    // Do not split surrogate pairs
+    auto length = subtext_term_length - 1;
+    if (raw[length - 1].isHighSurrogate())
+        --length;
+    return Plugin::tr("Search %1 for '%2'").arg(name_, raw.left(length) + u'…');
+}
+
+unique_ptr<Icon> SearchItem::icon() const
+{ return Icon::image(icon_path_); }
+
+QString SearchItem::inputActionText() const
+{ return input_prefix_ + term_->raw(); }
+
+vector<Action> SearchItem::actions() const
+{
+    return {{
+        u"run"_s, Plugin::tr("Run websearch"),
+        [usage=usage_, history=history_, opener=opener_, id=engine_id_, urls=url_templates_, term=term_]{
+            usage->record(id);
+            history->record(id, term->raw());
+            QStringList expanded;
+            for (const auto &url : urls)
+                expanded << term->expand(url);
+            opener->open(expanded);
+        }
+    }};
+}
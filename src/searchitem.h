@@ -0,0 +1,51 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "searchterm.h"
+#include <QStringList>
+#include <albert/item.h>
+#include <memory>
+class SearchHistory;
+class UrlOpener;
+class UsageStore;
+
+///
+/// A websearch item.
+///
+/// Construction is cheap regardless of the length of the search term. The
+/// subtext is built on demand and elides long terms, the URLs are expanded
+/// on activation. The input action text is the input prefix followed by
+/// the term, e.g. "gh " and the term for keyword matches or the term only
+/// for pattern matches.
+///
+class SearchItem : public albert::Item
+{
+public:
+    SearchItem(const QString &engine_id,
+               const QString &name,
+               const QString &input_prefix,
+               const QString &icon_path,
+               QStringList url_templates,
+               std::shared_ptr<const SearchTerm> term,
+               UsageStore *usage,
+               SearchHistory *history,
+               UrlOpener *opener);
+
+    QString id() const override;
+    QString text() const override;
+    QString subtext() const override;
+    std::unique_ptr<albert::Icon> icon() const override;
+    QString inputActionText() const override;
+    std::vector<albert::Action> actions() const override;
+
+private:
+    const QString engine_id_;
+    const QString name_;
+    const QString input_prefix_;
+    const QString icon_path_;
+    const QStringList url_templates_;
+    const std::shared_ptr<const SearchTerm> term_;
+    UsageStore * const usage_;
+    SearchHistory * const history_;
+    UrlOpener * const opener_;
+};
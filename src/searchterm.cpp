@@ -0,0 +1,207 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "searchterm.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <array>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WEBSEARCH_SSE2
+#endif
+using namespace std;
+
+namespace {
+
+enum class Mode { Percent, Form, Path };
+
+enum : unsigned char { Unreserved = 1, PathChar = 2 };
+
+// RFC 3986 character classes of the ASCII range
+static constexpr auto char_classes = []
+{
+    array<unsigned char, 128> t{};
+    for (int c = '0'; c <= '9'; ++c) t[c] = Unreserved;
+    for (int c = 'A'; c <= 'Z'; ++c) t[c] = Unreserved;
+    for (int c = 'a'; c <= 'z'; ++c) t[c] = Unreserved;
+    for (char c : {'-', '.', '_', '~'}) t[c] = Unreserved;
+    for (char c : {'!', '$', '&', '\'', '(', ')', '*', '+', ',', ';', '=', ':', '@'}) t[c] = PathChar;
+    return t;
+}();
+
+static const char16_t hex_digits[] = u"0123456789ABCDEF";
+
+static bool isUnreserved(char16_t c)
+{ return c < 0x80 && char_classes[c] == Unreserved; }
+
+// Returns the length of the run of unreserved chars at the beginning of [p, end)
+static qsizetype unreservedRun(const char16_t *p, const char16_t *end)
+{
+    const auto *begin = p;
+#ifdef WEBSEARCH_SSE2
+    // Eight chars at a time. Non-ASCII chars are negative or above 'z' as signed shorts.
+    const auto in = [](__m128i v, short lo, short hi)
+    { return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(lo - 1)),
+                           _mm_cmplt_epi16(v, _mm_set1_epi16(hi + 1))); };
+    const auto is = [](__m128i v, short c)
+    { return _mm_cmpeq_epi16(v, _mm_set1_epi16(c)); };
+
+    for (; end - p >= 8; p += 8)
+    {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto alnum = _mm_or_si128(in(v, '0', '9'), _mm_or_si128(in(v, 'A', 'Z'), in(v, 'a', 'z')));
+        const auto marks = _mm_or_si128(_mm_or_si128(is(v, '-'), is(v, '.')),
+                                        _mm_or_si128(is(v, '_'), is(v, '~')));
+        const auto bits = static_cast<uint>(_mm_movemask_epi8(_mm_or_si128(alnum, marks)));
+        if (bits != 0xFFFF)
+            return p - begin + qCountTrailingZeroBits(~bits) / 2;
+    }
+#endif
+    while (p != end && isUnreserved(*p))
+        ++p;
+    return p - begin;
+}
+
+// Converts UTF-16 to UTF-8 and percent-escapes it in one pass. Writes to out
+// if Write is set, returns the exact length of the encoding in either case.
+template<bool Write>
+static qsizetype encodeUtf16(const char16_t *p, const char16_t *end, Mode mode, char16_t *out)
+{
+    qsizetype n = 0;
+
+    const auto put = [&](char16_t c)
+    {
+        if constexpr (Write)
+            out[n] = c;
+        ++n;
+    };
+
+    const auto escape = [&](char32_t byte)
+    {
+        if constexpr (Write)
+        {
+            out[n] = u'%';
+            out[n + 1] = hex_digits[byte >> 4 & 0xF];
+            out[n + 2] = hex_digits[byte & 0xF];
+        }
+        n += 3;
+    };
+
+    while (p != end)
+    {
+        if (isUnreserved(*p))
+        {
+            const auto run = unreservedRun(p, end);
+            if constexpr (Write)
+                copy(p, p + run, out + n);
+            n += run;
+            p += run;
+            continue;
+        }
+
+        char32_t c = *p++;
+        if (c < 0x80)
+        {
+            if (mode == Mode::Path && char_classes[c] == PathChar)
+                put(char16_t(c));
+            else if (mode == Mode::Form && c == u' ')
+                put(u'+');
+            else
+                escape(c);
+            continue;
+        }
+
+        // Lone surrogates become U+FFFD, as in QString::toUtf8
+        if (QChar::isHighSurrogate(c) && p != end && QChar::isLowSurrogate(*p))
+            c = QChar::surrogateToUcs4(char16_t(c), *p++);
+        else if (QChar::isSurrogate(c))
+            c = QChar::ReplacementCharacter;
+
+        if (c < 0x800)
+            escape(0xC0 | c >> 6);
+        else
+        {
+            if (c < 0x10000)
+                escape(0xE0 | c >> 12);
+            else
+            {
+                escape(0xF0 | c >> 18);
+                escape(0x80 | (c >> 12 & 0x3F));
+            }
+            escape(0x80 | (c >> 6 & 0x3F));
+        }
+        escape(0x80 | (c & 0x3F));
+    }
+    return n;
+}
+
+static QString encode(const QString &s, Mode mode)
+{
+    // A sizing pass avoids reallocations and the worst case allocation of
+    // nine chars per input char. Both passes skip unreserved runs fast.
+    const auto *b = s.utf16(), *e = b + s.size();
+    QString out(encodeUtf16<false>(b, e, mode, nullptr), Qt::Uninitialized);
+    encodeUtf16<true>(b, e, mode, reinterpret_cast<char16_t*>(out.data()));
+    return out;
+}
+
+}
+
+SearchTerm::SearchTerm(const QString &raw) : raw_(raw) {}
+
+const QString &SearchTerm::raw() const
+{ return raw_; }
+
+const QString &SearchTerm::percentEncoded() const
+{
+    call_once(percent_once_, [this]{ percent_ = encode(raw_, Mode::Percent); });
+    return percent_;
+}
+
+const QString &SearchTerm::formEncoded() const
+{
+    call_once(form_once_, [this]{ form_ = encode(raw_, Mode::Form); });
+    return form_;
+}
+
+const QString &SearchTerm::pathEncoded() const
+{
+    call_once(path_once_, [this]{ path_ = encode(raw_, Mode::Path); });
+    return path_;
+}
+
+QString SearchTerm::expand(const QString &url_template) const
+{
+    QString url;
+    url.reserve(url_template.size());
+
+    static const QString none;
+    qsizetype pos = 0;
+    for (qsizetype i = url_template.indexOf(u'%'); i >= 0 && i + 1 < url_template.size();
+         i = url_template.indexOf(u'%', i + 1))
+    {
+        const QString *replacement;
+        qsizetype end = i + 2;
+        switch (url_template[i + 1].unicode())
+        {
+        case u's': replacement = &percentEncoded(); break;
+        case u'q': replacement = &formEncoded(); break;
+        case u'p': replacement = &pathEncoded(); break;
+        case u'r': replacement = &raw_; break;
+        case u'{':
+            // Capture groups of pattern engines matched by keyword or as fallback
+            while (end < url_template.size() && u'0' <= url_template[end] && url_template[end] <= u'9')
+                ++end;
+            if (end == i + 2 || end == url_template.size() || url_template[end] != u'}')
+                continue;
+            replacement = end == i + 3 && url_template[i + 2] == u'0' ? &percentEncoded() : &none;
+            ++end;
+            break;
+        default: continue;
+        }
+        url.append(QStringView(url_template).sliced(pos, i - pos)).append(*replacement);
+        i = end - 1;  // Skip the placeholder
+        pos = end;
+    }
+    url.append(QStringView(url_template).sliced(pos));
+    return url;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <mutex>
+
+///
+/// A search term and its encodings.
+///
+/// Each encoding is computed at most once, on first use. Items of a query
+/// share one instance, such that a term is encoded once per query instead of
+/// once per engine. Thread-safe.
+///
+/// URL templates may contain the placeholders
+///   %s  percent-encoded term, spaces as %20
+///   %q  form-encoded term, spaces as +
+///   %p  path segment, sub-delimiters, ':' and '@' kept
+///   %r  raw term
+///   %{0} percent-encoded term, as the whole match of a pattern
+///   %{n} empty, the capture groups of patterns are set on pattern matches only
+///
+class SearchTerm
+{
+public:
+    explicit SearchTerm(const QString &raw);
+
+    const QString &raw() const;
+    const QString &percentEncoded() const;
+    const QString &formEncoded() const;
+    const QString &pathEncoded() const;
+
+    /// Returns url_template with the placeholders replaced in a single pass.
+    QString expand(const QString &url_template) const;
+
+private:
+    const QString raw_;
+    mutable QString percent_;
+    mutable QString form_;
+    mutable QString path_;
+    mutable std::once_flag percent_once_;
+    mutable std::once_flag form_once_;
+    mutable std::once_flag path_once_;
+};
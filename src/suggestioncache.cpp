@@ -0,0 +1,116 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "suggestioncache.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QtConcurrentRun>
+#include <algorithm>
+using namespace std;
+
+// Record format: compact JSON array [<msecs since epoch>, <engine id>, <folded term>, [<suggestion>, …]]
+
+static const qint64 time_to_live = 7 * 24 * 60 * 60 * 1000;  // 7 days in msecs
+static const qsizetype max_entries = 10000;
+
+SuggestionCache::SuggestionCache(const QString &path) : log_(path) {}
+
+SuggestionCache::~SuggestionCache()
+{ loader_.waitForFinished(); }
+
+QString SuggestionCache::fold(const QString &term)
+{ return term.simplified().toCaseFolded(); }
+
+void SuggestionCache::load()
+{
+    Index entries;
+    const auto records = log_.read();
+    const auto expiry = QDateTime::currentMSecsSinceEpoch() - time_to_live;
+    for (const auto &record : records)
+    {
+        const auto a = QJsonDocument::fromJson(record).array();
+        if (a.size() != 4)
+            continue;
+
+        if (const auto timestamp = a[0].toInteger(); timestamp > expiry)
+            entries.insert({a[1].toString(), a[2].toString()},
+                           {timestamp, a[3].toVariant().toStringList()});
+        else
+            entries.remove({a[1].toString(), a[2].toString()});
+    }
+
+    // Entries inserted while loading are newer
+    QMutexLocker l(&mutex_);
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it)
+        entries.insert(it.key(), it.value());
+    entries_ = ::move(entries);
+    records_ += records.size();
+    loaded_ = true;
+
+    if (records_ > 2 * entries_.size() + 64 || entries_.size() > max_entries)
+        compact();
+}
+
+void SuggestionCache::compact()
+{
+    // Drop expired entries and keep the newest max_entries
+    const auto expiry = QDateTime::currentMSecsSinceEpoch() - time_to_live;
+    vector<qint64> timestamps;
+    for (auto it = entries_.begin(); it != entries_.end();)
+        if (it->timestamp <= expiry)
+            it = entries_.erase(it);
+        else
+            timestamps.emplace_back((it++)->timestamp);
+
+    if (entries_.size() > max_entries)
+    {
+        auto nth = timestamps.end() - max_entries;
+        nth_element(timestamps.begin(), nth, timestamps.end());
+        entries_.removeIf([min=*nth](const auto &it){ return it.value().timestamp < min; });
+    }
+
+    QList<QByteArray> records;
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it)
+        records.emplace_back(QJsonDocument(QJsonArray{
+            it->timestamp, it.key().first, it.key().second,
+            QJsonArray::fromStringList(it->suggestions)}).toJson(QJsonDocument::Compact));
+    records_ = records.size();
+    log_.rewrite(::move(records));
+}
+
+optional<QStringList> SuggestionCache::get(const QString &engine_id, const QString &term)
+{
+    QMutexLocker l(&mutex_);
+    if (!loaded_)
+    {
+        if (!loading_)
+        {
+            loading_ = true;
+            loader_ = QtConcurrent::run([this]{ load(); });
+        }
+        return {};
+    }
+
+    if (auto it = entries_.constFind({engine_id, fold(term)}); it != entries_.cend()
+        && it->timestamp > QDateTime::currentMSecsSinceEpoch() - time_to_live)
+        return it->suggestions;
+
+    return {};
+}
+
+void SuggestionCache::insert(const QString &engine_id, const QString &term, const QStringList &suggestions)
+{
+    const auto timestamp = QDateTime::currentMSecsSinceEpoch();
+    const auto folded = fold(term);
+    QMutexLocker l(&mutex_);
+    entries_.insert({engine_id, folded}, {timestamp, suggestions});
+
+    log_.append(QJsonDocument(QJsonArray{timestamp, engine_id, folded,
+                                         QJsonArray::fromStringList(suggestions)})
+                    .toJson(QJsonDocument::Compact));
+
+    // A rewrite before loading would drop the records not loaded yet
+    if (++records_ > 2 * entries_.size() + 64 || entries_.size() > max_entries + max_entries / 4)
+        if (loaded_)
+            compact();
+}
@@ -0,0 +1,50 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "appendlog.h"
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <optional>
+
+///
+/// Persistent, size bounded suggestion cache with expiring entries.
+///
+/// Keyed by engine id and case folded term. Backed by an append-only log
+/// that is loaded in the background on first access and compacted when it
+/// grows. Thread-safe.
+///
+class SuggestionCache
+{
+public:
+    explicit SuggestionCache(const QString &path);
+    ~SuggestionCache();
+
+    /// Returns the suggestions for term if cached and not expired.
+    /// Nothing until loaded.
+    std::optional<QStringList> get(const QString &engine_id, const QString &term);
+    void insert(const QString &engine_id, const QString &term, const QStringList &suggestions);
+
+    static QString fold(const QString &term);
+
+private:
+    struct Entry
+    {
+        qint64 timestamp;
+        QStringList suggestions;
+    };
+
+    using Index = QHash<std::pair<QString, QString>, Entry>;
+
+    void load();
+    void compact();  // Requires mutex_ and the log loaded
+
+    AppendLog log_;
+    QMutex mutex_;
+    QFuture<void> loader_;
+    Index entries_;  // Inserted ones only while loading
+    qsizetype records_ = 0;
+    bool loading_ = false;
+    bool loaded_ = false;
+};
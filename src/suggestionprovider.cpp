@@ -0,0 +1,163 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "searchterm.h"
+#include "suggestionprovider.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrl>
+#include <albert/logging.h>
+#include <albert/networkutil.h>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+static const int debounce_delay = 50;  // msecs
+static const int poll_interval = 10;  // msecs
+
+struct SuggestionProvider::Request
+{
+    QString key;
+    QString engine_id;
+    QString term;
+    QUrl url;
+    QNetworkReply *reply = nullptr;
+    bool finished = false;
+    bool cancelled = false;
+    QStringList suggestions;
+};
+
+SuggestionProvider::SuggestionProvider(const QString &cache_path):
+    cache_(256),
+    persistent_cache_(cache_path)
+{}
+
+SuggestionProvider::~SuggestionProvider()
+{
+    QMutexLocker l(&mutex_);
+    for (auto &request : pending_)
+    {
+        request->cancelled = true;
+        if (request->reply)
+        {
+            request->reply->disconnect(this);
+            request->reply->abort();
+            request->reply->deleteLater();
+        }
+        finish(*request, {});
+    }
+}
+
+shared_ptr<SuggestionProvider::Request>
+SuggestionProvider::request(const QString &engine_id, const QString &url_template, const QString &term)
+{
+    auto request = make_shared<Request>();
+    request->key = engine_id + u'\n' + term;
+
+    QMutexLocker l(&mutex_);
+
+    if (const auto *suggestions = cache_.object(request->key))
+    {
+        request->suggestions = *suggestions;
+        request->finished = true;
+        return request;
+    }
+
+    if (auto suggestions = persistent_cache_.get(engine_id, term))
+    {
+        cache_.insert(request->key, new QStringList(*suggestions));
+        request->suggestions = ::move(*suggestions);
+        request->finished = true;
+        return request;
+    }
+
+    if (auto it = pending_.find(engine_id); it != pending_.end())
+    {
+        if ((*it)->key == request->key)
+            return *it;  // Coalesce
+
+        // Supersede
+        auto &superseded = *it;
+        superseded->cancelled = true;
+        if (superseded->reply)
+            QMetaObject::invokeMethod(superseded->reply, &QNetworkReply::abort, Qt::QueuedConnection);
+        finish(*superseded, {});
+    }
+
+    request->engine_id = engine_id;
+    request->term = term;
+    request->url = QUrl(SearchTerm(term).expand(url_template));
+    pending_.insert(engine_id, request);
+
+    QMetaObject::invokeMethod(this, [this, request]{
+        QTimer::singleShot(debounce_delay, this, [this, request]{ fetch(request); });
+    });
+
+    return request;
+}
+
+void SuggestionProvider::fetch(shared_ptr<Request> request)
+{
+    QMutexLocker l(&mutex_);
+    if (request->cancelled)
+        return;
+
+    auto *reply = network().get(QNetworkRequest(request->url));
+    request->reply = reply;
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, request]
+    {
+        reply->deleteLater();
+
+        QStringList suggestions;
+        if (reply->error() == QNetworkReply::NoError)
+            // OpenSearch suggestions: ["term", ["suggestion", …], …]
+            suggestions = QJsonDocument::fromJson(reply->readAll())
+                              .array().at(1).toVariant().toStringList();
+        else if (reply->error() != QNetworkReply::OperationCanceledError)
+            WARN << u"Fetching suggestions failed: %1"_s.arg(reply->errorString());
+
+        QMutexLocker ml(&mutex_);
+        request->reply = nullptr;
+        if (request->cancelled)
+            return;
+
+        if (reply->error() == QNetworkReply::NoError)
+        {
+            cache_.insert(request->key, new QStringList(suggestions));
+            persistent_cache_.insert(request->engine_id, request->term, suggestions);
+        }
+
+        for (auto it = pending_.begin(); it != pending_.end(); ++it)
+            if (*it == request)
+            {
+                pending_.erase(it);
+                break;
+            }
+
+        finish(*request, suggestions);
+    });
+}
+
+void SuggestionProvider::finish(Request &request, QStringList suggestions)
+{
+    request.suggestions = ::move(suggestions);
+    request.finished = true;
+    finished_.wakeAll();
+}
+
+QStringList SuggestionProvider::result(const shared_ptr<Request> &request,
+                                       QDeadlineTimer deadline,
+                                       const function<bool()> &valid)
+{
+    QMutexLocker l(&mutex_);
+
+    // Poll validity, the query may be discarded while waiting
+    while (!request->finished && !deadline.hasExpired() && valid())
+        finished_.wait(&mutex_, QDeadlineTimer(deadline.isForever()
+                                               ? poll_interval
+                                               : min<qint64>(poll_interval, deadline.remainingTime())));
+
+    return request->finished ? request->suggestions : QStringList{};
+}
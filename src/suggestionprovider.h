@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "suggestioncache.h"
+#include <QCache>
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+class QNetworkReply;
+
+///
+/// Asynchronous provider of OpenSearch search suggestions.
+///
+/// Network requests are debounced per engine, superseded requests are
+/// cancelled and results are kept in an LRU cache backed by a persistent
+/// cache. Lives in the main thread, request() and result() are thread-safe.
+///
+class SuggestionProvider : public QObject
+{
+public:
+    struct Request;
+
+    explicit SuggestionProvider(const QString &cache_path);
+    ~SuggestionProvider();
+
+    /// Requests suggestions for term from the url template of the engine.
+    /// Supersedes the pending request of the engine if the term differs.
+    std::shared_ptr<Request> request(const QString &engine_id,
+                                     const QString &url_template,
+                                     const QString &term);
+
+    /// Waits for the request until it finished, the deadline expired or
+    /// valid returned false, e.g. since the query got invalid, and returns
+    /// the suggestions available by then. Late ones are cached.
+    QStringList result(const std::shared_ptr<Request> &request,
+                       QDeadlineTimer deadline,
+                       const std::function<bool()> &valid);
+
+private:
+    void fetch(std::shared_ptr<Request> request);
+    void finish(Request &request, QStringList suggestions);  // Requires mutex_
+
+    QMutex mutex_;
+    QWaitCondition finished_;
+    QCache<QString, QStringList> cache_;  // "<engine id>\n<term>" to suggestions
+    SuggestionCache persistent_cache_;
+    QHash<QString, std::shared_ptr<Request>> pending_;  // Engine id to request
+};
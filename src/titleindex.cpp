@@ -0,0 +1,199 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "titleindex.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <albert/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <string_view>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+// Lines sort bytewise. Titles and keys contain no control chars, hence the
+// order of the lines equals the order of their keys.
+
+static const qsizetype run_size = 32 * 1024 * 1024;  // Bytes of records sorted in memory at once
+static const qsizetype max_line_length = 1024;  // Bytes, longer titles are skipped
+
+namespace {
+
+struct Line
+{
+    string_view key;
+    string_view title;
+    const char *next;
+};
+
+static Line parseLine(const char *p, const char *end)
+{
+    const auto *nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    const auto *line_end = nl ? nl : end;
+    const auto *tab = static_cast<const char*>(memchr(p, '\t', line_end - p));
+    const auto *title = tab ? tab + 1 : line_end;
+    return {string_view(p, (tab ? tab : line_end) - p),
+            string_view(title, line_end - title),
+            nl ? nl + 1 : end};
+}
+
+static QString normalized(const QString &title)
+{
+    auto s = title.simplified();
+    s.removeIf([](QChar c){ return c.unicode() < 0x20; });
+    return s;
+}
+
+}
+
+TitleIndex::TitleIndex(const QString &path) : file_(path)
+{
+    if (!file_.open(QIODevice::ReadOnly) || file_.size() == 0)
+        return;
+
+    if (auto *data = file_.map(0, file_.size()))
+    {
+        data_ = reinterpret_cast<const char*>(data);
+        size_ = file_.size();
+    }
+    else
+        WARN << u"Could not map title index '%1': %2"_s.arg(path, file_.errorString());
+}
+
+bool TitleIndex::isValid() const
+{ return data_; }
+
+QString TitleIndex::path() const
+{ return file_.fileName(); }
+
+QStringList TitleIndex::complete(const QString &prefix, qsizetype limit) const
+{
+    const auto key = normalized(prefix).toCaseFolded().toUtf8();
+    if (!data_ || key.isEmpty())
+        return {};
+
+    const string_view k(key.constData(), key.size());
+    const auto *end = data_ + size_;
+
+    // Binary search for the first line with a key not less than k. lo is
+    // a line start, hi a line start or end. Lines before lo are less than k,
+    // lines from hi on are not.
+    const char *lo = data_, *hi = end;
+    while (lo < hi)
+    {
+        const auto *mid = lo + (hi - lo) / 2;
+        const auto *s = mid == data_ ? mid : parseLine(mid - 1, end).next;  // First line start >= mid
+        if (s >= hi)
+            s = lo;  // No line starts in [mid, hi)
+
+        if (const auto line = parseLine(s, end); line.key < k)
+            lo = line.next;
+        else
+            hi = s;
+    }
+
+    QStringList titles;
+    for (auto line = parseLine(lo, end);
+         lo != end && titles.size() < limit && line.key.substr(0, k.size()) == k;
+         lo = line.next, line = parseLine(lo, end))
+        titles << QString::fromUtf8(line.title.data(), line.title.size());
+    return titles;
+}
+
+bool TitleIndex::build(const QString &titles_path, const QString &path, const atomic_bool &cancel)
+{
+    QFile in(titles_path);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        WARN << u"Could not read titles '%1': %2"_s.arg(titles_path, in.errorString());
+        return false;
+    }
+
+    // Sort runs of bounded size into temporary files next to the index
+    const QDir dir = QFileInfo(path).absoluteDir();
+    vector<unique_ptr<QTemporaryFile>> runs;
+    vector<QByteArray> records;
+    qsizetype run_bytes = 0;
+
+    const auto writeRun = [&]
+    {
+        sort(records.begin(), records.end());
+        auto run = make_unique<QTemporaryFile>(dir.filePath(u"titles-XXXXXX.run"_s));
+        if (!run->open())
+        {
+            WARN << u"Could not create temporary file: %1"_s.arg(run->errorString());
+            return false;
+        }
+        for (const auto &record : records)
+            run->write(record);
+        run->seek(0);
+        runs.emplace_back(::move(run));
+        records.clear();
+        run_bytes = 0;
+        return true;
+    };
+
+    while (!in.atEnd())
+    {
+        if (cancel)
+            return false;
+
+        const auto line = in.readLine();
+        if (line.size() > max_line_length)
+            continue;
+
+        const auto title = normalized(QString::fromUtf8(line));
+        if (title.isEmpty())
+            continue;
+
+        auto record = title.toCaseFolded().toUtf8() + '\t' + title.toUtf8() + '\n';
+        run_bytes += record.size();
+        records.emplace_back(::move(record));
+        if (run_bytes >= run_size && !writeRun())
+            return false;
+    }
+
+    if (!records.empty() && !writeRun())
+        return false;
+
+    // Merge the runs, dropping duplicates
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+    {
+        WARN << u"Could not write title index '%1': %2"_s.arg(path, out.errorString());
+        return false;
+    }
+
+    using Head = pair<QByteArray, size_t>;
+    const auto after = [](const Head &a, const Head &b){ return a.first > b.first; };
+    priority_queue<Head, vector<Head>, decltype(after)> heads(after);
+    for (size_t i = 0; i < runs.size(); ++i)
+        if (auto record = runs[i]->readLine(); !record.isEmpty())
+            heads.emplace(::move(record), i);
+
+    QByteArray previous;
+    while (!heads.empty())
+    {
+        if (cancel)
+            return false;
+
+        auto [record, i] = heads.top();
+        heads.pop();
+        if (record != previous)
+            out.write(record);
+        previous = ::move(record);
+        if (auto next = runs[i]->readLine(); !next.isEmpty())
+            heads.emplace(::move(next), i);
+    }
+
+    if (!out.commit())
+    {
+        WARN << u"Could not write title index '%1': %2"_s.arg(path, out.errorString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QFile>
+#include <QStringList>
+#include <atomic>
+
+///
+/// Read-only prefix index of titles, e.g. of a wiki.
+///
+/// The index is a memory mapped text file of lines "<key>\t<title>" sorted
+/// by key, the case folded title. Completions are a binary search for the
+/// first line of a prefix and a scan of the following lines.
+///
+class TitleIndex
+{
+public:
+    /// Maps the index file at path.
+    explicit TitleIndex(const QString &path);
+
+    bool isValid() const;
+
+    /// Returns the path of the index file.
+    QString path() const;
+
+    /// Returns up to limit titles starting with prefix, case-insensitive, in key order.
+    QStringList complete(const QString &prefix, qsizetype limit) const;
+
+    /// Builds an index file at path from the titles file, one title per
+    /// line. An external merge sort bounds the memory used for large
+    /// datasets. Returns false on failure or if canceled.
+    static bool build(const QString &titles_path, const QString &path,
+                      const std::atomic_bool &cancel);
+
+private:
+    QFile file_;
+    const char *data_ = nullptr;
+    qint64 size_ = 0;
+};
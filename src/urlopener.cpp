@@ -0,0 +1,61 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "urlopener.h"
+#include <QProcess>
+#include <QUrl>
+#include <albert/logging.h>
+using namespace Qt::StringLiterals;
+
+#if defined(Q_OS_MACOS)
+static const auto &opener = u"open"_s;
+#else
+static const auto &opener = u"xdg-open"_s;
+#endif
+
+UrlOpener::UrlOpener()
+{
+    worker_.setMaxThreadCount(1);
+}
+
+UrlOpener::~UrlOpener()
+{
+    worker_.waitForDone();
+}
+
+void UrlOpener::open(const QStringList &urls)
+{
+    QMutexLocker l(&mutex_);
+    pending_ << urls;
+    if (!draining_)
+    {
+        draining_ = true;
+        worker_.start([this]{ drain(); });
+    }
+}
+
+void UrlOpener::drain()
+{
+    for (;;)
+    {
+        QStringList batch;
+        {
+            QMutexLocker l(&mutex_);
+            if (pending_.isEmpty())
+            {
+                draining_ = false;
+                return;
+            }
+            batch.swap(pending_);
+        }
+
+        batch.removeDuplicates();
+        for (const auto &url : std::as_const(batch))
+        {
+            QUrl qurl(url);
+            if (!qurl.isValid() || qurl.scheme().isEmpty())
+                WARN << u"Invalid URL: '%1' %2"_s.arg(url, qurl.errorString());
+            else if (!QProcess::startDetached(opener, {qurl.toString(QUrl::FullyEncoded)}))
+                WARN << u"Failed to start %1 for URL: '%2'"_s.arg(opener, url);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+
+///
+/// Opens URLs on a background thread.
+///
+/// Spawning the URL handler may block for a noticeable time on some
+/// desktops. The worker spawns the opener of the platform, xdg-open or
+/// open, detached. QDesktopServices is not used, since it is not
+/// thread-safe. URLs opened while the worker is busy are coalesced into
+/// the next batch, duplicates in a batch are opened once.
+///
+class UrlOpener
+{
+public:
+    UrlOpener();
+    ~UrlOpener();
+
+    /// Queues urls for opening. Thread-safe and non-blocking.
+    void open(const QStringList &urls);
+
+private:
+    void drain();
+
+    QThreadPool worker_;
+    QMutex mutex_;
+    QStringList pending_;
+    bool draining_ = false;
+};
@@ -0,0 +1,74 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "usagestore.h"
+#include <QDateTime>
+#include <cmath>
+using namespace std;
+
+// Record format: <id>\t<msecs since epoch>\t<weight>
+
+static const double half_life = 30. * 24 * 60 * 60 * 1000;  // 30 days in msecs
+static const double min_weight = 0.01;
+
+UsageStore::UsageStore(const QString &path) : log_(path)
+{
+    const auto records = log_.read();
+    for (const auto &record : records)
+    {
+        const auto fields = record.split('\t');
+        if (fields.size() != 3)
+            continue;
+
+        Entry activation{fields[2].toDouble(), fields[1].toLongLong()};
+        const auto id = QString::fromUtf8(fields[0]);
+        if (auto it = entries_.find(id); it == entries_.end())
+            entries_.emplace(id, activation);
+        else
+            *it = {decayed(*it, activation.timestamp) + activation.weight, activation.timestamp};
+    }
+
+    // Compact the log if it consists mostly of single activations
+    if (records.size() > 2 * entries_.size() + 64)
+    {
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        QList<QByteArray> compacted;
+        for (auto it = entries_.begin(); it != entries_.end();)
+        {
+            if (auto w = decayed(*it, now); w < min_weight)
+                it = entries_.erase(it);
+            else
+            {
+                compacted.emplace_back(it.key().toUtf8() + '\t'
+                                       + QByteArray::number(now) + '\t'
+                                       + QByteArray::number(w));
+                *it = {w, now};
+                ++it;
+            }
+        }
+        log_.rewrite(::move(compacted));
+    }
+}
+
+double UsageStore::decayed(const Entry &entry, qint64 now)
+{ return entry.weight * exp2(-double(now - entry.timestamp) / half_life); }
+
+void UsageStore::record(const QString &id)
+{
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    {
+        QMutexLocker l(&mutex_);
+        if (auto it = entries_.find(id); it == entries_.end())
+            entries_.emplace(id, Entry{1., now});
+        else
+            *it = {decayed(*it, now) + 1., now};
+    }
+    log_.append(id.toUtf8() + '\t' + QByteArray::number(now) + "\t1");
+}
+
+double UsageStore::count(const QString &id) const
+{
+    QMutexLocker l(&mutex_);
+    if (auto it = entries_.find(id); it != entries_.end())
+        return decayed(*it, QDateTime::currentMSecsSinceEpoch());
+    return 0.;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#pragma once
+#include "appendlog.h"
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+///
+/// Persistent, exponentially decaying activation counters of search engines.
+///
+class UsageStore
+{
+public:
+    explicit UsageStore(const QString &path);
+
+    /// Records an activation of the engine with the given id. Thread-safe.
+    void record(const QString &id);
+
+    /// Returns the decayed activation count of the engine with the given id. Thread-safe.
+    double count(const QString &id) const;
+
+private:
+    struct Entry
+    {
+        double weight;
+        qint64 timestamp;
+    };
+
+    static double decayed(const Entry &entry, qint64 now);
+
+    AppendLog log_;
+    mutable QMutex mutex_;
+    QHash<QString, Entry> entries_;
+};
@@ -0,0 +1,186 @@
+// Copyright (c) 2024 Manuel Schneider
+
+#include "suggestionprovider.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QUuid>
+#include <albert/logging.h>
+ALBERT_LOGGING_CATEGORY("websearch")
+using namespace Qt::StringLiterals;
+using namespace std;
+
+///
+/// Local stand-in for a suggestion server.
+///
+/// Answers requests for the term of the q parameter with the OpenSearch
+/// suggestions "<term> one" and "<term> two", optionally delayed.
+///
+class StandInServer : public QTcpServer
+{
+public:
+    StandInServer()
+    {
+        connect(this, &QTcpServer::newConnection, this, [this]
+        {
+            while (auto *socket = nextPendingConnection())
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket]{ respond(socket); });
+        });
+        listen(QHostAddress::LocalHost);
+    }
+
+    QString urlTemplate() const
+    { return u"http://127.0.0.1:%1/suggest?q=%s"_s.arg(serverPort()); }
+
+    QStringList terms;  // Of the received requests
+    int delay = 0;  // msecs
+
+private:
+    void respond(QTcpSocket *socket)
+    {
+        if (!socket->peek(64 * 1024).contains("\r\n\r\n"))
+            return;  // Incomplete header
+
+        // GET /suggest?q=… HTTP/1.1
+        const auto target = socket->readAll().split(' ').value(1);
+        const auto term = QUrlQuery(QUrl(QString::fromUtf8(target)).query())
+                              .queryItemValue(u"q"_s, QUrl::FullyDecoded);
+        terms << term;
+
+        const auto body = QJsonDocument(QJsonArray{term, QJsonArray{term + u" one"_s, term + u" two"_s}})
+                              .toJson(QJsonDocument::Compact);
+        QTimer::singleShot(delay, socket, [socket, body]
+        {
+            socket->write("HTTP/1.1 200 OK\r\n"
+                          "Content-Type: application/x-suggestions+json\r\n"
+                          "Connection: close\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    }
+};
+
+static const auto always = []{ return true; };
+
+static QStringList expected(const QString &term)
+{ return {term + u" one"_s, term + u" two"_s}; }
+
+class SuggestionProviderTest : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir dir_;
+    QString cachePath() const { return dir_.filePath(QUuid::createUuid().toString()); }
+
+private slots:
+
+    void fetch()
+    {
+        StandInServer server;
+        SuggestionProvider provider(cachePath());
+        const auto request = provider.request(u"e"_s, server.urlTemplate(), u"foo bär"_s);
+        QTRY_COMPARE(provider.result(request, QDeadlineTimer(0), always), expected(u"foo bär"_s));
+        QCOMPARE(server.terms, QStringList{u"foo bär"_s});
+    }
+
+    void cached()
+    {
+        StandInServer server;
+        SuggestionProvider provider(cachePath());
+        auto request = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+        QTRY_COMPARE(provider.result(request, QDeadlineTimer(0), always), expected(u"foo"_s));
+
+        // Without processing events
+        request = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+        QCOMPARE(provider.result(request, QDeadlineTimer(0), always), expected(u"foo"_s));
+        QCOMPARE(server.terms.size(), 1);
+    }
+
+    void coalesce()
+    {
+        StandInServer server;
+        SuggestionProvider provider(cachePath());
+        const auto a = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+        const auto b = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+        QCOMPARE(a, b);
+        QTRY_COMPARE(provider.result(b, QDeadlineTimer(0), always), expected(u"foo"_s));
+        QCOMPARE(server.terms.size(), 1);
+    }
+
+    void supersede()
+    {
+        StandInServer server;
+        SuggestionProvider provider(cachePath());
+        const auto a = provider.request(u"e"_s, server.urlTemplate(), u"f"_s);
+        const auto b = provider.request(u"e"_s, server.urlTemplate(), u"fo"_s);
+        QVERIFY(provider.result(a, QDeadlineTimer::Forever, always).isEmpty());  // Finished, cancelled
+        QTRY_COMPARE(provider.result(b, QDeadlineTimer(0), always), expected(u"fo"_s));
+        QCOMPARE(server.terms, QStringList{u"fo"_s});  // Debounced
+    }
+
+    void budget()
+    {
+        StandInServer server;
+        server.delay = 1000;
+        SuggestionProvider provider(cachePath());
+        const auto request = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(provider.result(request, QDeadlineTimer(100), always).isEmpty());
+        QVERIFY(timer.elapsed() < 500);
+
+        // Invalidated queries stop waiting
+        timer.restart();
+        QVERIFY(provider.result(request, QDeadlineTimer::Forever, []{ return false; }).isEmpty());
+        QVERIFY(timer.elapsed() < 500);
+
+        // Late suggestions are cached for the next query
+        QTRY_COMPARE(provider.result(provider.request(u"e"_s, server.urlTemplate(), u"foo"_s),
+                                     QDeadlineTimer(0), always),
+                     expected(u"foo"_s));
+    }
+
+    void persistentCache()
+    {
+        const auto path = cachePath();
+        {
+            SuggestionCache cache(path);
+            cache.insert(u"e"_s, u"Foo  Bar"_s, {u"foo bar baz"_s});
+        }
+
+        // Loaded in the background on first access, keyed by the folded term
+        SuggestionCache cache(path);
+        QCOMPARE(cache.get(u"e"_s, u"foo bar"_s), nullopt);
+        QTRY_COMPARE(cache.get(u"e"_s, u"foo bar"_s), optional<QStringList>({u"foo bar baz"_s}));
+        QCOMPARE(cache.get(u"f"_s, u"foo bar"_s), nullopt);
+    }
+
+    void waitInWorker()
+    {
+        // As rankItems does, while the main thread runs the network
+        StandInServer server;
+        server.delay = 100;
+        SuggestionProvider provider(cachePath());
+        QStringList suggestions;
+        unique_ptr<QThread> thread(QThread::create([&]
+        {
+            const auto request = provider.request(u"e"_s, server.urlTemplate(), u"foo"_s);
+            suggestions = provider.result(request, QDeadlineTimer(5000), always);
+        }));
+        thread->start();
+        QTRY_VERIFY(thread->isFinished());
+        QCOMPARE(suggestions, expected(u"foo"_s));
+    }
+};
+
+QTEST_GUILESS_MAIN(SuggestionProviderTest)
+#include "suggestionprovidertest.moc"